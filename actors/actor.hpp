@@ -0,0 +1,237 @@
+#pragma once
+
+#include "../executors/iexecutor.hpp"
+#include "../intrusive/structures/stack.hpp"
+#include "../detail/slab_allocator.hpp"
+#include <atomic>
+#include <cassert>
+#include <limits>
+
+namespace Actors {
+
+    struct ActorOptions {
+        // TrySend fails while the mailbox holds so many messages, Send ignores the bound
+        size_t capacity = std::numeric_limits<size_t>::max();
+
+        // as in the strand : count of messages handled in one submission to the executor,
+        // before new arrivals are taken through the executor again, 0 - every refill is submitted
+        size_t drain_budget = 0;
+
+        // as in the strand : the batch of the idle actor runs next on the worker of the sender
+        bool affinity = false;
+    };
+
+    // snapshot of the counters, the actor isn't stopped
+    struct ActorStats {
+        uint64_t processed_count = 0;
+
+        // submissions of the actor to the executor
+        uint64_t batches_count = 0;
+
+        // messages refused by TrySend, because the mailbox was full
+        uint64_t rejected_count = 0;
+
+        // messages in the mailbox and in the running batch
+        size_t queued_count = 0;
+    };
+
+    // state is touched only by one routine at a time, messages are handled in the order of sending
+    // for every sender
+    //
+    // mailbox is the intrusive stack of message nodes from the slabs of the sender,
+    // so the message costs one allocation without the global heap and no task object
+    //
+    // actor must outlive its messages, so it is destroyed only when the mailbox is empty and the batch isn't running
+    template <typename State, typename Msg>
+    requires requires (State& state, Msg&& msg) { state.Receive(std::move(msg)); }
+    class Actor {
+    private:
+        struct MessageNode : Intrusive::SinglyDirectedListNode {
+            Msg msg;
+
+            explicit MessageNode(Msg&& msg) : msg(std::move(msg)) {
+            }
+
+            static void* operator new(size_t size) {
+                return Detail::SlabAllocator::Allocate(size, alignof(MessageNode));
+            }
+
+            static void operator delete(void* ptr, size_t size) {
+                Detail::SlabAllocator::Deallocate(ptr, size, alignof(MessageNode));
+            }
+        };
+
+        class MessagesBatch : public Intrusive::TaskBase {
+        public:
+            MessagesBatch() = default;
+
+            MessagesBatch(Intrusive::Stack stack, Actor* actor) : stack_(std::move(stack)), actor_(actor) {
+            }
+
+            bool AllocatedOnHeap() override {
+                return false;
+            }
+
+            void Run() override {
+                actor_->RunBatch(std::move(stack_));
+            }
+
+            void Discard() override {
+                assert(false);
+            }
+
+        private:
+            Intrusive::Stack stack_;
+            Actor* actor_ = nullptr;
+        };
+
+    public:
+        Actor(Executors::IExecutor& executor, State state, const ActorOptions& options = ActorOptions())
+            : executor_(&executor), state_(std::move(state)), options_(options) {
+        }
+
+        Actor(const Actor&) = delete;
+        Actor& operator=(const Actor&) = delete;
+
+        Actor(Actor&&) = delete;
+        Actor& operator=(Actor&&) = delete;
+
+        ~Actor() {
+            assert(head_.load(std::memory_order_relaxed) == nullptr);
+        }
+
+        // never fails, for messages that can't be dropped or delayed, e.g. replies of other actors
+        void Send(Msg&& msg) {
+            size_.fetch_add(1, std::memory_order_relaxed);
+            Push(new MessageNode(std::move(msg)));
+        }
+
+        // return false and leaves msg untouched, if the mailbox is full
+        bool TrySend(Msg&& msg) {
+            if (size_.fetch_add(1, std::memory_order_relaxed) >= options_.capacity) {
+                size_.fetch_sub(1, std::memory_order_relaxed);
+                rejected_count_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            Push(new MessageNode(std::move(msg)));
+            return true;
+        }
+
+        // only while the actor is idle, or from its own Receive
+        State& GetState() {
+            return state_;
+        }
+
+        [[nodiscard]] ActorStats GetStats() const {
+            ActorStats stats;
+            stats.processed_count = processed_count_.load(std::memory_order_relaxed);
+            stats.batches_count = batches_count_.load(std::memory_order_relaxed);
+            stats.rejected_count = rejected_count_.load(std::memory_order_relaxed);
+            stats.queued_count = size_.load(std::memory_order_relaxed);
+            return stats;
+        }
+
+    private:
+        void Push(MessageNode* node) {
+            Intrusive::SinglyDirectedListNode* head = head_.load(std::memory_order_relaxed);
+            do {
+                node->next = head;
+            } while (!head_.compare_exchange_weak(head, node, std::memory_order_acq_rel,
+                                                  std::memory_order_relaxed));
+            if (head == nullptr) {
+                Lock(options_.affinity);
+            }
+        }
+
+        // messages, that arrive while the batch runs, are taken in place till the drain budget is spent
+        void RunBatch(Intrusive::Stack stack) {
+            Add(batches_count_, 1);
+            size_t count = 0;
+            while (true) {
+                size_t round = 0;
+                MessageNode* node;
+                while ((node = (MessageNode*)stack.TryPop()) != nullptr) {
+                    state_.Receive(std::move(node->msg));
+                    delete node;
+                    ++round;
+                }
+                count += round;
+                Add(processed_count_, round);
+                size_.fetch_sub(round, std::memory_order_relaxed);
+
+                if (count >= options_.drain_budget) {
+                    Unlock();
+                    return;
+                }
+                if (TryUnlock()) {
+                    return;
+                }
+                stack = TakeArrivals();
+            }
+        }
+
+        void Lock(bool next) {
+            batch_ = MessagesBatch(TakeArrivals(), this);
+
+            if (next) {
+                executor_->ExecuteNext(&batch_);
+            }
+            else {
+                executor_->Execute(&batch_);
+            }
+        }
+
+        void Unlock() {
+            if (TryUnlock()) {
+                return;
+            }
+
+            // the budget is spent, so the actor doesn't take the LIFO slot again
+            Lock(false);
+        }
+
+        // return true if nothing has arrived, then the actor is idle
+        bool TryUnlock() {
+            auto* closed = (Intrusive::SinglyDirectedListNode*)kClosed;
+            // release : the next batch, which starts after the push into the empty mailbox, sees the state
+            return head_.compare_exchange_strong(closed, nullptr, std::memory_order_release,
+                                                 std::memory_order_relaxed);
+        }
+
+        // the actor stays locked, messages are reversed into the order of sending
+        Intrusive::Stack TakeArrivals() {
+            auto* head = head_.exchange((Intrusive::SinglyDirectedListNode*)kClosed, std::memory_order_acquire);
+            Intrusive::Stack result;
+            while (head != nullptr && head != (Intrusive::SinglyDirectedListNode*)kClosed) {
+                auto* next = head->next;
+                result.Push(head);
+                head = next;
+            }
+            return result;
+        }
+
+        // counters are written only by the running batch
+        static void Add(std::atomic<uint64_t>& counter, uint64_t value) {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+    private:
+        // because pointer occupied only last 48 bits
+        static const uint64_t kClosed = ((uint64_t)1 << 63);
+
+        Executors::IExecutor* executor_;
+        State state_;
+        const ActorOptions options_;
+
+        // nullptr - idle, kClosed - the batch runs and nothing has arrived
+        std::atomic<Intrusive::SinglyDirectedListNode*> head_{ nullptr };
+        std::atomic<size_t> size_{ 0 };
+
+        std::atomic<uint64_t> processed_count_{ 0 };
+        std::atomic<uint64_t> batches_count_{ 0 };
+        std::atomic<uint64_t> rejected_count_{ 0 };
+
+        MessagesBatch batch_;
+    };
+
+}
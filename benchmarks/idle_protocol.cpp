@@ -0,0 +1,87 @@
+// wake ups of the idle workers :
+// burst - a batch of routines is submitted at once, the idle workers must ramp up quickly,
+// trickle - routines come one by one with pauses, a single worker is enough for them
+//
+// voluntary context switches of the process are the blocked futex waits of the workers,
+// usage : benchmark_idle_protocol [burst|trickle] [workers]
+
+#include "../executors/thread_pool/with_waitidle/thread_pool.hpp"
+#include "../executors/api.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <sys/resource.h>
+#include <thread>
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    long VoluntarySwitches() {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_nvcsw;
+    }
+
+    void Spin(std::chrono::nanoseconds duration) {
+        auto deadline = Clock::now() + duration;
+        while (Clock::now() < deadline) {
+        }
+    }
+
+    void Report(const char* name, Clock::time_point start, long switches, size_t routines) {
+        std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+        std::cout << name << " : " << elapsed.count() << " ms, "
+                  << (double)(VoluntarySwitches() - switches) / (double)routines << " switches per routine\n";
+    }
+
+    void Burst(size_t workers) {
+        constexpr size_t kBursts = 200;
+        constexpr size_t kBurstSize = 1000;
+
+        Executors::WithWaitIdle::ThreadPool pool{ workers };
+        long switches = VoluntarySwitches();
+        auto start = Clock::now();
+        for (size_t i = 0; i < kBursts; ++i) {
+            for (size_t j = 0; j < kBurstSize; ++j) {
+                Executors::Execute(pool, [] {
+                    Spin(std::chrono::microseconds(1));
+                });
+            }
+            pool.WaitIdle();
+        }
+        Report("burst", start, switches, kBursts * kBurstSize);
+        pool.Stop();
+    }
+
+    void Trickle(size_t workers) {
+        constexpr size_t kRoutines = 20'000;
+
+        Executors::WithWaitIdle::ThreadPool pool{ workers };
+        long switches = VoluntarySwitches();
+        auto start = Clock::now();
+        for (size_t i = 0; i < kRoutines; ++i) {
+            Executors::Execute(pool, [] {
+                Spin(std::chrono::microseconds(1));
+            });
+            Spin(std::chrono::microseconds(20));
+        }
+        pool.WaitIdle();
+        Report("trickle", start, switches, kRoutines);
+        pool.Stop();
+    }
+
+}
+
+int main(int argc, char** argv) {
+    std::string mode = (argc > 1 ? argv[1] : "all");
+    size_t workers = (argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 4);
+
+    if (mode == "all" || mode == "burst") {
+        Burst(workers);
+    }
+    if (mode == "all" || mode == "trickle") {
+        Trickle(workers);
+    }
+}
@@ -0,0 +1,64 @@
+// many producers, which are not workers of the pool, submit trivial routines at once,
+// so every routine goes through the global injection queue
+//
+// usage : benchmark_injection_queue [workers] [routines per producer]
+
+#include "../executors/thread_pool/with_waitidle/thread_pool.hpp"
+#include "../executors/api.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    // routines per second
+    double Run(size_t workers, size_t producers, size_t routines) {
+        Executors::WithWaitIdle::ThreadPool pool{ workers };
+        std::atomic<size_t> done{ 0 };
+        std::atomic<bool> go{ false };
+
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < producers; ++i) {
+            threads.emplace_back([&] {
+                while (!go.load(std::memory_order_acquire)) {
+                    std::this_thread::yield();
+                }
+                for (size_t j = 0; j < routines; ++j) {
+                    Executors::Execute(pool, [&done] {
+                        done.fetch_add(1, std::memory_order_relaxed);
+                    });
+                }
+            });
+        }
+
+        auto start = Clock::now();
+        go.store(true, std::memory_order_release);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        pool.WaitIdle();
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+        pool.Stop();
+
+        return (double)done.load() / elapsed.count();
+    }
+
+}
+
+int main(int argc, char** argv) {
+    size_t workers = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4);
+    size_t routines = (argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200'000);
+
+    for (size_t producers : { 1, 4, 16, 32 }) {
+        double best = 0;
+        for (int round = 0; round < 5; ++round) {
+            best = std::max(best, Run(workers, producers, routines / producers));
+        }
+        std::cout << "producers " << producers << " : " << (size_t)(best / 1000) << "k routines/s\n";
+    }
+}
@@ -0,0 +1,73 @@
+// steal-heavy fork-join load on the simulated topology, so it runs on a machine with one node :
+// every routine forks two children in the local queue of its worker, idle workers steal them
+//
+// uniform - one node, any victim is as good as another, it is how victims were chosen before the NUMA mode,
+// numa - the workers are split into two simulated nodes, same node victims go first
+//
+// usage : benchmark_numa_steal [workers]
+
+#include "../executors/thread_pool/with_waitidle/thread_pool.hpp"
+#include "../executors/api.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    void Spin(std::chrono::nanoseconds duration) {
+        auto deadline = Clock::now() + duration;
+        while (Clock::now() < deadline) {
+        }
+    }
+
+    // binary tree of routines, the stolen subtrees fill the local queues of the thieves
+    void Fork(Executors::WithWaitIdle::ThreadPool& pool, size_t depth) {
+        if (depth == 0) {
+            Spin(std::chrono::microseconds(2));
+            return;
+        }
+        for (size_t i = 0; i < 2; ++i) {
+            Executors::Execute(pool, [&pool, depth] {
+                Fork(pool, depth - 1);
+            });
+        }
+    }
+
+    void Run(const char* name, Executors::WithWaitIdle::ThreadPool& pool) {
+        constexpr size_t kRounds = 50;
+        constexpr size_t kDepth = 12;
+
+        auto start = Clock::now();
+        for (size_t round = 0; round < kRounds; ++round) {
+            Executors::Execute(pool, [&pool] {
+                Fork(pool, kDepth);
+            });
+            pool.WaitIdle();
+        }
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+
+        auto stats = pool.GetStats().total;
+        double routines = (double)(kRounds * ((2 << kDepth) - 1));
+        std::cout << name << " : " << (size_t)(routines / elapsed.count() / 1000) << "k routines/s, "
+                  << stats.steal_successes_count << " steals, " << stats.remote_steals_count << " remote\n";
+    }
+
+}
+
+int main(int argc, char** argv) {
+    size_t workers = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 8);
+
+    {
+        Executors::WithWaitIdle::ThreadPool pool{ workers };
+        Run("uniform", pool);
+        pool.Stop();
+    }
+    {
+        Executors::WithWaitIdle::ThreadPool pool{ workers, Executors::NumaTopology::Simulate(2, workers),
+                                                  /*pin_workers=*/false };
+        Run("numa", pool);
+        pool.Stop();
+    }
+}
@@ -0,0 +1,78 @@
+// latency of the high priority probes, while the pool is saturated by the low priority load :
+// every load routine resubmits itself, so the queues never run dry
+//
+// same lane - the load and the probes are Priority::kNormal, as if there were no priorities,
+// priority lanes - the load is Priority::kLow and the probes are Priority::kHigh
+//
+// usage : benchmark_priority_latency [workers]
+
+#include "../executors/thread_pool/with_waitidle/thread_pool.hpp"
+#include "../executors/api.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+    using Executors::WithWaitIdle::Priority;
+    using Executors::WithWaitIdle::ThreadPool;
+
+    void Spin(std::chrono::nanoseconds duration) {
+        auto deadline = Clock::now() + duration;
+        while (Clock::now() < deadline) {
+        }
+    }
+
+    void Load(ThreadPool& pool, std::atomic<bool>& stopped, Priority priority) {
+        Spin(std::chrono::microseconds(20));
+        if (!stopped.load(std::memory_order_relaxed)) {
+            pool.Execute(Executors::MakeRoutine([&pool, &stopped, priority] {
+                Load(pool, stopped, priority);
+            }), priority);
+        }
+    }
+
+    void Run(const char* name, size_t workers, Priority load_priority, Priority probe_priority) {
+        constexpr size_t kLoadPerWorker = 64;
+        constexpr size_t kProbes = 2000;
+
+        ThreadPool pool{ workers };
+        std::atomic<bool> stopped{ false };
+        for (size_t i = 0; i < workers * kLoadPerWorker; ++i) {
+            pool.Execute(Executors::MakeRoutine([&pool, &stopped, load_priority] {
+                Load(pool, stopped, load_priority);
+            }), load_priority);
+        }
+
+        // submission to start of the probe
+        std::vector<double> latencies(kProbes, 0);
+        for (size_t i = 0; i < kProbes; ++i) {
+            auto submitted = Clock::now();
+            pool.Execute(Executors::MakeRoutine([&latencies, i, submitted] {
+                latencies[i] = std::chrono::duration<double, std::micro>(Clock::now() - submitted).count();
+            }), probe_priority);
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+
+        stopped.store(true, std::memory_order_relaxed);
+        pool.WaitIdle();
+        pool.Stop();
+
+        std::sort(latencies.begin(), latencies.end());
+        std::cout << name << " : p50 " << latencies[kProbes / 2] << " us, p99 " << latencies[kProbes * 99 / 100]
+                  << " us\n";
+    }
+
+}
+
+int main(int argc, char** argv) {
+    size_t workers = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4);
+
+    Run("same lane", workers, Priority(Priority::kNormal), Priority(Priority::kNormal));
+    Run("priority lanes", workers, Priority(Priority::kLow), Priority(Priority::kHigh));
+}
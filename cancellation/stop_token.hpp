@@ -0,0 +1,221 @@
+#pragma once
+
+#include "../detail/spinlock.hpp"
+#include "../intrusive/structures/list.hpp"
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace Cancellation {
+
+    // exception of the future, whose work was skipped after the stop request
+    class OperationCancelled : public std::runtime_error {
+    public:
+        OperationCancelled() : std::runtime_error("operation cancelled") {
+        }
+    };
+
+    // registered in the stop state, OnStop is called at most once by the thread, that requests stop
+    class StopCallback : public Intrusive::BidirectionalListNode {
+    public:
+        virtual void OnStop() = 0;
+
+    private:
+        friend class StopState;
+
+        enum State {
+            kIdle,
+            kRegistered,
+            kRunning,
+            kDone,
+        };
+
+        // changes from kRegistered only under the spinlock of the stop state,
+        // so Unregister takes the spinlock only for the registered callback
+        std::atomic<State> state_{ kIdle };
+    };
+
+    // shared by the source and its tokens, callbacks are called without the spinlock,
+    // so the callback can take locks of the waiters, which register callbacks under their locks
+    class StopState {
+    public:
+        [[nodiscard]] bool StopRequested() const {
+            return stopped_.load(std::memory_order_acquire);
+        }
+
+        // return false if stop was already requested
+        bool RequestStop() {
+            {
+                ::Detail::QueueSpinLock::Guard guard(spinlock_);
+                if (stopped_.load(std::memory_order_relaxed)) {
+                    return false;
+                }
+                stopped_.store(true, std::memory_order_release);
+                stopping_thread_ = std::this_thread::get_id();
+            }
+
+            while (true) {
+                ::Detail::QueueSpinLock::Guard guard(spinlock_);
+                auto* callback = (StopCallback*)callbacks_.TryPopFront();
+                if (callback == nullptr) {
+                    return true;
+                }
+                callback->state_.store(StopCallback::kRunning, std::memory_order_release);
+                guard.Unlock();
+
+                callback->OnStop();
+                callback->state_.store(StopCallback::kDone, std::memory_order_release);
+            }
+        }
+
+        // return false if stop was already requested, then the callback isn't registered
+        bool Register(StopCallback* callback) {
+            ::Detail::QueueSpinLock::Guard guard(spinlock_);
+            if (stopped_.load(std::memory_order_relaxed)) {
+                return false;
+            }
+            callbacks_.PushBack(callback);
+            callback->state_.store(StopCallback::kRegistered, std::memory_order_relaxed);
+            return true;
+        }
+
+        // waits for the callback, if it is running on the other thread,
+        // so the callback can be destroyed right after it
+        void Unregister(StopCallback* callback) {
+            auto state = callback->state_.load(std::memory_order_acquire);
+            if (state == StopCallback::kRegistered) {
+                ::Detail::QueueSpinLock::Guard guard(spinlock_);
+                state = callback->state_.load(std::memory_order_relaxed);
+                if (state == StopCallback::kRegistered) {
+                    callbacks_.Unlink(callback);
+                    callback->state_.store(StopCallback::kIdle, std::memory_order_relaxed);
+                    return;
+                }
+            }
+
+            // the callback can unregister itself from OnStop
+            if (state != StopCallback::kRunning || stopping_thread_ == std::this_thread::get_id()) {
+                return;
+            }
+            while (callback->state_.load(std::memory_order_acquire) == StopCallback::kRunning) {
+                std::this_thread::yield();
+            }
+        }
+
+        void AddOwner() {
+            owners_count_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void RemoveOwner() {
+            if (owners_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                delete this;
+            }
+        }
+
+    private:
+        std::atomic<bool> stopped_{ false };
+        std::atomic<size_t> owners_count_{ 1 };
+
+        ::Detail::QueueSpinLock spinlock_;
+        Intrusive::List callbacks_;
+        std::thread::id stopping_thread_;
+    };
+
+    // default token never stops
+    class StopToken {
+    public:
+        friend class StopSource;
+
+        StopToken() = default;
+
+        StopToken(const StopToken& other) : state_(other.state_) {
+            if (state_ != nullptr) {
+                state_->AddOwner();
+            }
+        }
+
+        StopToken(StopToken&& other) noexcept : state_(std::exchange(other.state_, nullptr)) {
+        }
+
+        StopToken& operator=(StopToken other) noexcept {
+            std::swap(state_, other.state_);
+            return *this;
+        }
+
+        ~StopToken() noexcept {
+            if (state_ != nullptr) {
+                state_->RemoveOwner();
+            }
+        }
+
+        [[nodiscard]] bool StopRequested() const {
+            return (state_ != nullptr && state_->StopRequested());
+        }
+
+        [[nodiscard]] bool StopPossible() const {
+            return (state_ != nullptr);
+        }
+
+        // return false if stop was already requested, then the callback isn't registered
+        bool Register(StopCallback* callback) const {
+            return (state_ == nullptr || state_->Register(callback));
+        }
+
+        // after it the callback isn't running and won't be called
+        void Unregister(StopCallback* callback) const {
+            if (state_ != nullptr) {
+                state_->Unregister(callback);
+            }
+        }
+
+    private:
+        explicit StopToken(StopState* state) : state_(state) {
+            state_->AddOwner();
+        }
+
+    private:
+        StopState* state_ = nullptr;
+    };
+
+    // usage :
+    // Cancellation::StopSource source;
+    // Channel.Receive(source.GetToken()); // <-- in the fiber
+    // source.RequestStop();               // <-- from anywhere, the fiber is resumed with std::nullopt
+    class StopSource {
+    public:
+        StopSource() : state_(new StopState) {
+        }
+
+        StopSource(const StopSource& other) : state_(other.state_) {
+            state_->AddOwner();
+        }
+
+        StopSource& operator=(const StopSource& other) {
+            StopSource copy(other);
+            std::swap(state_, copy.state_);
+            return *this;
+        }
+
+        ~StopSource() noexcept {
+            state_->RemoveOwner();
+        }
+
+        [[nodiscard]] StopToken GetToken() const {
+            return StopToken(state_);
+        }
+
+        // callbacks are called on the current thread, return false if stop was already requested
+        bool RequestStop() {
+            return state_->RequestStop();
+        }
+
+        [[nodiscard]] bool StopRequested() const {
+            return state_->StopRequested();
+        }
+
+    private:
+        StopState* state_;
+    };
+
+}
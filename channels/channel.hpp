@@ -6,8 +6,8 @@
 #include "../detail/spinlock.hpp"
 #include "../fibers/awaiters.hpp"
 #include "../fibers/api.hpp"
-#include "../intrusive/structures/queue.hpp"
 #include "../intrusive/structures/list.hpp"
+#include "../cancellation/stop_token.hpp"
 
 namespace Channels {
 
@@ -34,10 +34,34 @@ namespace Channels {
 
                 Fibers::Awaiters::ChannelProducerAwaiter<T> awaiter(Fibers::Fiber::Self(),
                                                                     std::forward<T>(value), guard);
-                producers_queue_.Push(&awaiter);
+                producers_queue_.PushBack(&awaiter);
                 Fibers::Self::Suspend(&awaiter);
             }
 
+            // return false if stop is requested before the value is taken, then the value is left in value
+            bool Send(T&& value, Cancellation::StopToken token) {
+                ::Detail::QueueSpinLock::Guard guard(spinlock_);
+                if (TrySendImpl(std::forward<T>(value))) {
+                    return true;
+                }
+                if (token.StopRequested()) {
+                    return false;
+                }
+
+                auto self = Fibers::Fiber::Self();
+                Fibers::Awaiters::ListTimeout stop(self, Executors::Clock::time_point::max(),
+                                                   producers_queue_, spinlock_, std::move(token));
+                Fibers::Awaiters::ChannelProducerAwaiter<T> awaiter(self, std::forward<T>(value), guard, &stop);
+                producers_queue_.PushBack(&awaiter);
+                Fibers::Self::Suspend(&awaiter);
+
+                if (stop.Cancelled()) {
+                    value = std::move(awaiter.GetValue());
+                    return false;
+                }
+                return true;
+            }
+
             bool TrySend(T&& value) {
                 ::Detail::QueueSpinLock::Guard guard(spinlock_);
                 return TrySendImpl(std::forward<T>(value));
@@ -59,6 +83,28 @@ namespace Channels {
                 return std::move(*result);
             }
 
+            // return std::nullopt if deadline fires or stop is requested before the value comes
+            std::optional<T> ReceiveUntil(Executors::Clock::time_point deadline,
+                                          Cancellation::StopToken token = {}) {
+                ::Detail::QueueSpinLock::Guard guard(spinlock_);
+                if (tail_ - head_ > 0) {
+                    std::optional<T> result = { std::move(buffer_[(head_++) % kCapacity]) };
+                    TryTakeValueFromProducersQueue();
+                    return result;
+                }
+                if (token.StopRequested()) {
+                    return std::nullopt;
+                }
+
+                std::optional<T> result;
+                auto self = Fibers::Fiber::Self();
+                Fibers::Awaiters::ListTimeout timeout(self, deadline, consumers_queue_, spinlock_, std::move(token));
+                Fibers::Awaiters::ChannelConsumerAwaiter<T> awaiter(self, result, guard, &timeout);
+                consumers_queue_.PushBack(&awaiter);
+                Fibers::Self::Suspend(&awaiter);
+                return result;
+            }
+
             std::optional<T> TryReceive() {
                 ::Detail::QueueSpinLock::Guard guard(spinlock_);
                 if (tail_ - head_ > 0) {
@@ -72,10 +118,13 @@ namespace Channels {
 
         private:
             bool TrySendImpl(T&& value) {
-                if (consumers_queue_.Size() > 0) {
+                // timed out consumers are skipped, they leave by themselves
+                while (consumers_queue_.Size() > 0) {
                     auto* awaiter = (Fibers::Awaiters::IChannelConsumerAwaiter<T>*)consumers_queue_.TryPopFront();
-                    awaiter->Resume(std::forward<T>(value));
-                    return true;
+                    if (awaiter->TryAcquire()) {
+                        awaiter->Resume(std::forward<T>(value));
+                        return true;
+                    }
                 }
 
                 if (tail_ - head_ < kCapacity) {
@@ -86,20 +135,27 @@ namespace Channels {
                 return false;
             }
 
+            // cancelled producers are skipped, they leave by themselves
             void TryTakeValueFromProducersQueue() {
-                if (producers_queue_.Size() > 0) {
-                    auto* awaiter = (Fibers::Awaiters::ChannelProducerAwaiter<T>*)producers_queue_.TryPop();
-                    buffer_[(tail_++) % kCapacity] = std::move(awaiter->Resume());
+                while (producers_queue_.Size() > 0) {
+                    auto* awaiter = (Fibers::Awaiters::ChannelProducerAwaiter<T>*)producers_queue_.TryPopFront();
+                    if (awaiter->TryAcquire()) {
+                        buffer_[(tail_++) % kCapacity] = std::move(awaiter->Resume());
+                        return;
+                    }
                 }
             }
 
+            // return true if the select is resolved : by this channel or by the other winner
             bool SelectorReceive(Fibers::Awaiters::ChannelConsumerAwaiterBase* awaiter) {
                 ::Detail::QueueSpinLock::Guard guard(spinlock_);
                 auto* result_awaiter = (Fibers::Awaiters::IChannelConsumerAwaiter<T>*)awaiter;
 
                 if (tail_ - head_ > 0) {
-                    result_awaiter->Resume(std::move(buffer_[(head_++) % kCapacity]));
-                    TryTakeValueFromProducersQueue();
+                    if (result_awaiter->TryAcquire()) {
+                        result_awaiter->Resume(std::move(buffer_[(head_++) % kCapacity]));
+                        TryTakeValueFromProducersQueue();
+                    }
                     return true;
                 }
 
@@ -108,6 +164,15 @@ namespace Channels {
                 return false;
             }
 
+            // awaiter of the select leaves, if no producer has popped it
+            void SelectorUnlink(Fibers::Awaiters::ChannelConsumerAwaiterBase* awaiter) {
+                ::Detail::QueueSpinLock::Guard guard(spinlock_);
+                if (awaiter->GetQueue() != nullptr) {
+                    consumers_queue_.Unlink(awaiter);
+                    awaiter->SetQueue(nullptr);
+                }
+            }
+
         private:
             const size_t kCapacity;
             std::unique_ptr<T[]> buffer_;
@@ -118,7 +183,7 @@ namespace Channels {
             ::Detail::QueueSpinLock spinlock_;
 
             Intrusive::List consumers_queue_;
-            Intrusive::Queue producers_queue_;
+            Intrusive::List producers_queue_;
         };
 
 
@@ -131,6 +196,8 @@ namespace Channels {
             virtual bool Receive(Fibers::Awaiters::ChannelConsumerAwaiterBase*) = 0;
 
             virtual bool TryReceive(Variant& result) = 0;
+
+            virtual void Unlink(Fibers::Awaiters::ChannelConsumerAwaiterBase*) = 0;
         };
 
         template <typename T, typename Variant, size_t AwaitersCount>
@@ -153,6 +220,10 @@ namespace Channels {
                 return true;
             }
 
+            void Unlink(Fibers::Awaiters::ChannelConsumerAwaiterBase* awaiter) override {
+                impl_->SelectorUnlink(awaiter);
+            }
+
         private:
             ChannelImpl<T>* impl_ = nullptr;
         };
@@ -178,6 +249,11 @@ namespace Channels {
             impl_->Send(std::forward<T>(value));
         }
 
+        // return false if stop is requested before the value is taken, then the value is left in value
+        bool Send(T&& value, Cancellation::StopToken token) {
+            return impl_->Send(std::forward<T>(value), std::move(token));
+        }
+
         bool TrySend(T&& value) {
             return impl_->TrySend(std::forward<T>(value));
         }
@@ -186,6 +262,19 @@ namespace Channels {
             return std::move(impl_->Receive());
         }
 
+        // return std::nullopt if stop is requested before the value comes
+        std::optional<T> Receive(Cancellation::StopToken token) {
+            return impl_->ReceiveUntil(Executors::Clock::time_point::max(), std::move(token));
+        }
+
+        std::optional<T> ReceiveUntil(Executors::Clock::time_point deadline, Cancellation::StopToken token = {}) {
+            return impl_->ReceiveUntil(deadline, std::move(token));
+        }
+
+        std::optional<T> ReceiveFor(Executors::Clock::duration timeout, Cancellation::StopToken token = {}) {
+            return impl_->ReceiveUntil(Executors::Clock::now() + timeout, std::move(token));
+        }
+
         std::optional<T> TryReceive() {
             return std::move(impl_->TryReceive());
         }
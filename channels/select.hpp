@@ -181,23 +181,20 @@ namespace Channels {
 
             template <size_t Ind, size_t ArraySize, typename MaybeSelectorValue, typename X, typename ...Args>
             struct GetAwaiters {
-                static void Get(TypeTraits::MultiTypeArray<Fibers::Awaiters::SelectorAwaiter<X, MaybeSelectorValue,
-                                ArraySize>, Fibers::Awaiters::SelectorAwaiter<Args, MaybeSelectorValue,
-                                ArraySize>...>& arr, std::array<std::pair<Intrusive::BidirectionalListNode*,
-                                Intrusive::List*>, ArraySize>& awaiters) {
+                static void Get(TypeTraits::MultiTypeArray<Fibers::Awaiters::SelectorAwaiter<X, MaybeSelectorValue>,
+                                Fibers::Awaiters::SelectorAwaiter<Args, MaybeSelectorValue>...>& arr,
+                                std::array<Fibers::Awaiters::ChannelConsumerAwaiterBase*, ArraySize>& awaiters) {
                     auto& awaiter = TypeTraits::Get<Ind>(arr);
-                    awaiter.SetIndex(Ind);
-                    awaiters[Ind] = { (Intrusive::BidirectionalListNode*)&awaiter, nullptr };
+                    awaiters[Ind] = &awaiter;
                     GetAwaiters<Ind + 1, ArraySize, MaybeSelectorValue, X, Args...>::Get(arr, awaiters);
                 }
             };
 
             template <size_t Ind, typename MaybeSelectorValue, typename X, typename ...Args>
             struct GetAwaiters<Ind, Ind, MaybeSelectorValue, X, Args...> {
-                static void Get(TypeTraits::MultiTypeArray<Fibers::Awaiters::SelectorAwaiter<X, MaybeSelectorValue,
-                        Ind>, Fibers::Awaiters::SelectorAwaiter<Args, MaybeSelectorValue,
-                        Ind>...>&, std::array<std::pair<Intrusive::BidirectionalListNode*,
-                        Intrusive::List*>, Ind>&) {
+                static void Get(TypeTraits::MultiTypeArray<Fibers::Awaiters::SelectorAwaiter<X, MaybeSelectorValue>,
+                                Fibers::Awaiters::SelectorAwaiter<Args, MaybeSelectorValue>...>&,
+                                std::array<Fibers::Awaiters::ChannelConsumerAwaiterBase*, Ind>&) {
                 }
             };
         }
@@ -213,7 +210,8 @@ namespace Channels {
             static constexpr size_t kArgsCount = TypeTraits::GetArgsCount<X, Args...>::kArgsCount;
 
         public:
-            static MaybeSelectorValue Select(Channel<X>& xs, Channel<Args>&... args) {
+            // return std::monostate if stop is requested before any value comes
+            static MaybeSelectorValue Select(Cancellation::StopToken token, Channel<X>& xs, Channel<Args>&... args) {
                 TypeTraits::MultiTypeArray<ChannelForSelect<X, MaybeSelectorValue, kArgsCount>,
                         ChannelForSelect<Args,
                                 MaybeSelectorValue, kArgsCount>...> arr(GetChannelForSelect<X, MaybeSelectorValue, kArgsCount>(xs),
@@ -222,18 +220,19 @@ namespace Channels {
                         GetChannelArray(arr);
 
                 MaybeSelectorValue result = std::monostate();
-                std::atomic_flag is_result_set{ false };
-
-                std::array<std::pair<Intrusive::BidirectionalListNode*, Intrusive::List*>, kArgsCount> awaiters;
-
-                TypeTraits::MultiTypeArray<Fibers::Awaiters::SelectorAwaiter<X, MaybeSelectorValue, kArgsCount>,
-                        Fibers::Awaiters::SelectorAwaiter<Args, MaybeSelectorValue, kArgsCount>...> awaiters_arr(
-                                Fibers::Awaiters::SelectorAwaiter<X, MaybeSelectorValue, kArgsCount>(
-                                        Fibers::Fiber::Self(), result, awaiters, is_result_set
-                                        ),
-                                Fibers::Awaiters::SelectorAwaiter<Args, MaybeSelectorValue, kArgsCount>(
-                                        Fibers::Fiber::Self(), result, awaiters, is_result_set
-                                        )...
+                Fibers::Awaiters::SelectState state(Fibers::Fiber::Self());
+
+                Fibers::Awaiters::SelectStopCallback stop(state);
+                if (!token.Register(&stop)) {
+                    return result;
+                }
+
+                std::array<Fibers::Awaiters::ChannelConsumerAwaiterBase*, kArgsCount> awaiters;
+
+                TypeTraits::MultiTypeArray<Fibers::Awaiters::SelectorAwaiter<X, MaybeSelectorValue>,
+                        Fibers::Awaiters::SelectorAwaiter<Args, MaybeSelectorValue>...> awaiters_arr(
+                                Fibers::Awaiters::SelectorAwaiter<X, MaybeSelectorValue>(state, result),
+                                Fibers::Awaiters::SelectorAwaiter<Args, MaybeSelectorValue>(state, result)...
                                 );
 
                 ForSelector::GetAwaiters<0, kArgsCount, MaybeSelectorValue, X, Args...>::Get(awaiters_arr, awaiters);
@@ -241,15 +240,28 @@ namespace Channels {
                 GenerateRandomPermutation(channels, awaiters);
 
                 for (size_t i = 0; i < kArgsCount; ++i) {
-                    if (channels[i]->Receive((Fibers::Awaiters::ChannelConsumerAwaiterBase*)(awaiters[i].first))) {
-                        return std::move(result);
+                    if (channels[i]->Receive(awaiters[i])) {
+                        break;
                     }
                 }
 
-                Fibers::Self::Suspend((Fibers::Awaiters::ChannelConsumerAwaiterBase*)awaiters[0].first);
+                // the winner sets the flag after the result, so the result is ready, if the flag is set
+                if (!state.is_result_set.test(std::memory_order_acquire)) {
+                    Fibers::Self::Suspend(awaiters[0]);
+                }
+
+                // the losers are skipped by the producers, but they are still in the queues
+                for (size_t i = 0; i < kArgsCount; ++i) {
+                    channels[i]->Unlink(awaiters[i]);
+                }
+                token.Unregister(&stop);
                 return std::move(result);
             }
 
+            static MaybeSelectorValue Select(Channel<X>& xs, Channel<Args>&... args) {
+                return Select(Cancellation::StopToken(), xs, args...);
+            }
+
             static MaybeSelectorValue TrySelect(Channel<X>& xs, Channel<Args>&... args) {
                 TypeTraits::MultiTypeArray<ChannelForSelect<X, MaybeSelectorValue, kArgsCount>,
                         ChannelForSelect<Args,
@@ -277,15 +289,13 @@ namespace Channels {
 
 
             static void GenerateRandomPermutation(std::array<IChannelForSelect<MaybeSelectorValue, kArgsCount>*,
-                    kArgsCount>& channels, std::array<std::pair<Intrusive::BidirectionalListNode*, Intrusive::List*>,
+                    kArgsCount>& channels, std::array<Fibers::Awaiters::ChannelConsumerAwaiterBase*,
                             kArgsCount>& awaiters) {
                 std::uniform_int_distribution<int> D;
                 for (int i = kArgsCount - 1; i > 0; --i) {
                     int index = D(generator, std::uniform_int_distribution<int>::param_type(0, i));
                     std::swap(channels[i], channels[index]);
-                    std::swap(awaiters[i].first, awaiters[index].first);
-
-                    ((Fibers::Awaiters::ChannelConsumerAwaiterBase*)awaiters[i].first)->SetIndex(i);
+                    std::swap(awaiters[i], awaiters[index]);
                 }
             }
 
@@ -307,6 +317,12 @@ namespace Channels {
         return Detail::Selector<X, Args...>::Select(xs, args...);
     }
 
+    // return std::monostate if stop is requested before any value comes
+    template <typename X, typename ...Args>
+    auto Select(Cancellation::StopToken token, Channel<X>& xs, Channel<Args>&... args) {
+        return Detail::Selector<X, Args...>::Select(std::move(token), xs, args...);
+    }
+
     template <typename X, typename ...Args>
     auto TrySelect(Channel<X>& xs, Channel<Args>&... args) {
         return Detail::Selector<X, Args...>::TrySelect(xs, args...);
@@ -3,7 +3,11 @@
 #include <functional>
 #include <cassert>
 #include <exception>
+#include <type_traits>
+#include <memory>
 #include <boost/context/continuation_fcontext.hpp>
+#include <boost/context/preallocated.hpp>
+#include "stack_pool.hpp"
 
 
 namespace Coroutines::Stackful {
@@ -14,23 +18,23 @@ namespace Coroutines::Stackful {
 
     class Coroutine {
     public:
-        explicit Coroutine(Routine routine) : routine_(std::move(routine)) {
-            coroutine_ = boost::context::callcc([this, routine = routine_](boost::context::continuation&& sink) {
-                suspend_ = &sink;
-                Suspend();
-                is_started_ = true;
-                try {
-                    routine();
-                }
-                catch(...) {
-                    exception_ = std::current_exception();
-                }
-
-                is_completed_ = true;
-                Suspend();
+        // body is moved into the coroutine stack, next to the context of boost::context,
+        // so there is no std::function and no extra copy
+        template <typename Body>
+        requires std::is_invocable_v<std::decay_t<Body>&>
+        explicit Coroutine(Body&& body) {
+            // stacks are recycled by StackPool instead of being mapped for every coroutine
+            coroutine_ = boost::context::callcc(std::allocator_arg, PooledStackAllocator(),
+                                                MakeEntry(std::forward<Body>(body)));
+        }
 
-                return std::move(sink);
-            });
+        // stack is allocated from StackPool by the caller, who may keep own data above stack.sp,
+        // stack.sctx is returned to StackPool, when the coroutine is destroyed
+        template <typename Body>
+        requires std::is_invocable_v<std::decay_t<Body>&>
+        Coroutine(Body&& body, boost::context::preallocated stack) {
+            coroutine_ = boost::context::callcc(std::allocator_arg, stack, PooledStackAllocator(),
+                                                MakeEntry(std::forward<Body>(body)));
         }
 
         Coroutine(const Coroutine&) = delete;
@@ -69,13 +73,33 @@ namespace Coroutines::Stackful {
             }
         }
 
+    private:
+        template <typename Body>
+        auto MakeEntry(Body&& body) {
+            return [this, body = std::forward<Body>(body)](boost::context::continuation&& sink) mutable {
+                suspend_ = &sink;
+                Suspend();
+                is_started_ = true;
+                try {
+                    body();
+                }
+                catch(...) {
+                    exception_ = std::current_exception();
+                }
+
+                is_completed_ = true;
+                Suspend();
+
+                return std::move(sink);
+            };
+        }
+
     private:
         boost::context::continuation coroutine_;
         boost::context::continuation* suspend_{ nullptr };
 
         bool is_completed_{ false };
         bool is_started_{ false };
-        Routine routine_;
 
         std::exception_ptr exception_{ nullptr };
     };
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <boost/context/stack_context.hpp>
+#include <boost/context/stack_traits.hpp>
+
+namespace Coroutines::Stackful {
+
+    // mmap'd coroutine stacks with the guard page below, recycled instead of unmapping
+    //
+    // stack is taken from the cache of the current thread, then from the shared list,
+    // and only then is mapped, released stack goes to the cache of the releasing thread,
+    // overflow of the cache goes to the shared list, overflow of the shared list is unmapped
+    //
+    // workers of the executor run and finish fibers, so their caches serve almost every spawn without locks
+    class StackPool {
+    public:
+        using Stack = boost::context::stack_context;
+
+        struct Options {
+            // usable size, rounded up to pages, guard page is extra
+            size_t stack_size = boost::context::stack_traits::default_size();
+
+            size_t thread_cache_size = 64;
+            size_t shared_cache_size = 1024;
+
+            // cached stacks give their pages back (MADV_DONTNEED), so RSS is capped by the running coroutines,
+            // but the reused stack is faulted in again
+            bool release_memory = false;
+        };
+
+        // stacks of the other size are unmapped, when they come back
+        static void SetOptions(const Options& options) {
+            stack_size_.store(RoundUpToPages(options.stack_size), std::memory_order_relaxed);
+            thread_cache_size_.store(options.thread_cache_size, std::memory_order_relaxed);
+            shared_cache_size_.store(options.shared_cache_size, std::memory_order_relaxed);
+            release_memory_.store(options.release_memory, std::memory_order_relaxed);
+        }
+
+        static Options GetOptions() {
+            Options options;
+            options.stack_size = stack_size_.load(std::memory_order_relaxed);
+            options.thread_cache_size = thread_cache_size_.load(std::memory_order_relaxed);
+            options.shared_cache_size = shared_cache_size_.load(std::memory_order_relaxed);
+            options.release_memory = release_memory_.load(std::memory_order_relaxed);
+            return options;
+        }
+
+        static Stack Allocate() {
+            size_t stack_size = stack_size_.load(std::memory_order_relaxed);
+
+            Stack stack;
+            if (local_cache_.destroyed) [[unlikely]] {
+                return TakeFromShared(stack_size);
+            }
+            if (TryTakeFromLocalCache(stack_size, stack)) {
+                return stack;
+            }
+
+            // the half of the local cache is refilled at once, so the shared lock is taken rarely
+            {
+                auto& local_cache = local_cache_.stacks;
+                auto& shared = GetShared();
+                std::lock_guard guard(shared.mutex);
+                size_t count = std::min(shared.stacks.size(),
+                                        std::max<size_t>(thread_cache_size_.load(std::memory_order_relaxed) / 2, 1));
+                local_cache.insert(local_cache.end(), shared.stacks.end() - (ptrdiff_t)count, shared.stacks.end());
+                shared.stacks.resize(shared.stacks.size() - count);
+            }
+            if (TryTakeFromLocalCache(stack_size, stack)) {
+                return stack;
+            }
+
+            return Map(stack_size);
+        }
+
+        static void Deallocate(Stack& stack) {
+            if (stack.size != stack_size_.load(std::memory_order_relaxed)) {
+                Unmap(stack);
+                return;
+            }
+
+            if (release_memory_.load(std::memory_order_relaxed)) {
+                madvise((char*)stack.sp - stack.size, stack.size, MADV_DONTNEED);
+            }
+
+            // the fiber has finished during the teardown of the thread, after its cache is gone
+            if (local_cache_.destroyed) [[unlikely]] {
+                ReleaseToShared(stack);
+                return;
+            }
+
+            auto& local_cache = local_cache_.stacks;
+            size_t cache_size = thread_cache_size_.load(std::memory_order_relaxed);
+            if (local_cache.size() >= cache_size) {
+                // the local cache is left half-full, so the shared lock is taken rarely,
+                // it is emptied, if the limit is 0 or 1, or it has become smaller by SetOptions
+                MoveToShared(local_cache, local_cache.size() - cache_size / 2);
+            }
+            local_cache.push_back(stack);
+            if (local_cache.size() > cache_size) {
+                MoveToShared(local_cache, 1);
+            }
+        }
+
+    private:
+        struct Shared {
+            std::mutex mutex;
+            std::vector<Stack> stacks;
+        };
+
+        struct LocalCache {
+            std::vector<Stack> stacks;
+            // set by the destructor, the cache isn't used after it, the stacks go through the shared list
+            bool destroyed = false;
+
+            ~LocalCache() {
+                destroyed = true;
+                MoveToShared(stacks, stacks.size());
+            }
+        };
+
+        static size_t PageSize() {
+            static const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+            return page_size;
+        }
+
+        static size_t RoundUpToPages(size_t size) {
+            size_t page_size = PageSize();
+            return std::max((size + page_size - 1) / page_size, (size_t)1) * page_size;
+        }
+
+        // stack grows down, so the guard page is at the lowest address
+        static Stack Map(size_t stack_size) {
+            size_t page_size = PageSize();
+            void* region = mmap(nullptr, stack_size + page_size, PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+            if (region == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            // the stack without the guard page isn't given out, the overflow would corrupt the memory below
+            if (mprotect(region, page_size, PROT_NONE) != 0) {
+                munmap(region, stack_size + page_size);
+                throw std::bad_alloc();
+            }
+
+            Stack stack;
+            stack.size = stack_size;
+            stack.sp = (char*)region + page_size + stack_size;
+            return stack;
+        }
+
+        static void Unmap(Stack& stack) {
+            size_t page_size = PageSize();
+            munmap((char*)stack.sp - stack.size - page_size, stack.size + page_size);
+        }
+
+        // stacks of the old size are unmapped on the way
+        static bool TryTakeFromLocalCache(size_t stack_size, Stack& stack) {
+            auto& local_cache = local_cache_.stacks;
+            while (!local_cache.empty()) {
+                stack = local_cache.back();
+                local_cache.pop_back();
+                if (stack.size == stack_size) {
+                    return true;
+                }
+                Unmap(stack);
+            }
+            return false;
+        }
+
+        // moves count last stacks, the rest of the shared overflow is unmapped
+        static void MoveToShared(std::vector<Stack>& stacks, size_t count) {
+            auto& shared = GetShared();
+            std::lock_guard guard(shared.mutex);
+            size_t shared_cache_size = shared_cache_size_.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < count; ++i) {
+                if (shared.stacks.size() < shared_cache_size) {
+                    shared.stacks.push_back(stacks.back());
+                }
+                else {
+                    Unmap(stacks.back());
+                }
+                stacks.pop_back();
+            }
+        }
+
+        // for the thread without the cache, stacks of the old size are unmapped on the way
+        static Stack TakeFromShared(size_t stack_size) {
+            {
+                auto& shared = GetShared();
+                std::lock_guard guard(shared.mutex);
+                while (!shared.stacks.empty()) {
+                    Stack stack = shared.stacks.back();
+                    shared.stacks.pop_back();
+                    if (stack.size == stack_size) {
+                        return stack;
+                    }
+                    Unmap(stack);
+                }
+            }
+            return Map(stack_size);
+        }
+
+        static void ReleaseToShared(Stack& stack) {
+            auto& shared = GetShared();
+            std::lock_guard guard(shared.mutex);
+            if (shared.stacks.size() < shared_cache_size_.load(std::memory_order_relaxed)) {
+                shared.stacks.push_back(stack);
+            }
+            else {
+                Unmap(stack);
+            }
+        }
+
+        // never destroyed : stacks can be released by threads that finish after static destructors
+        static Shared& GetShared() {
+            static auto* shared = new Shared;
+            return *shared;
+        }
+
+    private:
+        static thread_local LocalCache local_cache_;
+
+        static std::atomic<size_t> stack_size_;
+        static std::atomic<size_t> thread_cache_size_;
+        static std::atomic<size_t> shared_cache_size_;
+        static std::atomic<bool> release_memory_;
+    };
+
+    inline thread_local StackPool::LocalCache StackPool::local_cache_;
+
+    inline std::atomic<size_t> StackPool::stack_size_{ RoundUpToPages(Options().stack_size) };
+    inline std::atomic<size_t> StackPool::thread_cache_size_{ Options().thread_cache_size };
+    inline std::atomic<size_t> StackPool::shared_cache_size_{ Options().shared_cache_size };
+    inline std::atomic<bool> StackPool::release_memory_{ Options().release_memory };
+
+    // StackAllocator of boost::context over StackPool
+    class PooledStackAllocator {
+    public:
+        boost::context::stack_context allocate() {
+            return StackPool::Allocate();
+        }
+
+        void deallocate(boost::context::stack_context& stack) {
+            StackPool::Deallocate(stack);
+        }
+    };
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "task.hpp"
+#include "../../executors/iexecutor.hpp"
+#include <coroutine>
+#include <type_traits>
+
+namespace Tasks {
+
+    // co_await Schedule(executor) : the coroutine continues as a routine of the executor
+    //
+    // the awaiter lives in the coroutine frame and is the routine itself, so nothing is allocated
+    class ScheduleAwaiter : public Executors::Routine {
+    public:
+        explicit ScheduleAwaiter(Executors::IExecutor& executor) : executor_(executor) {
+            trampoline_ = &Resume;
+        }
+
+        bool await_ready() noexcept {
+            return false;
+        }
+
+        template <typename Promise>
+        void await_suspend(std::coroutine_handle<Promise> caller) {
+            caller_ = caller;
+            if constexpr (std::is_base_of_v<Detail::PromiseBase, Promise>) {
+                promise_ = &caller.promise();
+            }
+            executor_.Execute(this);
+        }
+
+        void await_resume() noexcept {
+        }
+
+        // the trampoline runs the routine without Discard, so only the dropped routine is discarded,
+        // true : executors discard the dropped routines only if they are allocated on heap
+        bool AllocatedOnHeap() override {
+            return true;
+        }
+
+        // executors without the trampoline call Run and then Discard, the frame with the awaiter
+        // may be gone after the coroutine is resumed, so Run only marks the routine, and Discard resumes it
+        void Run() override {
+            resumed_ = true;
+        }
+
+        // otherwise the executor is stopped, the coroutine is never resumed
+        void Discard() override {
+            if (resumed_) {
+                caller_.resume();
+                return;
+            }
+            if (promise_ != nullptr) {
+                promise_->DestroyDetachedRoot();
+            }
+        }
+
+    private:
+        static void Resume(TaskBase* task) {
+            static_cast<ScheduleAwaiter*>(task)->caller_.resume();
+        }
+
+    private:
+        Executors::IExecutor& executor_;
+        std::coroutine_handle<> caller_;
+        // if the coroutine is the task
+        Detail::PromiseBase* promise_ = nullptr;
+        bool resumed_ = false;
+    };
+
+    inline ScheduleAwaiter Schedule(Executors::IExecutor& executor) {
+        return ScheduleAwaiter(executor);
+    }
+
+    // the same, when the coroutine moves from one executor to another
+    inline ScheduleAwaiter TeleportTo(Executors::IExecutor& executor) {
+        return ScheduleAwaiter(executor);
+    }
+
+}
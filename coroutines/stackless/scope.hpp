@@ -0,0 +1,169 @@
+#pragma once
+
+#include "task.hpp"
+#include "schedule.hpp"
+#include "../../detail/scope_state.hpp"
+#include <atomic>
+#include <cassert>
+#include <coroutine>
+
+namespace Tasks {
+
+    // structured concurrency for stackless tasks
+    //
+    // usage (in a task) :
+    // Tasks::Scope scope(executor);
+    // scope.Spawn(Child());
+    // co_await scope.Join(); // <-- rethrows the first exception of the children
+    //
+    // child, that is dropped by the stopped executor, ends with Cancellation::OperationCancelled
+    //
+    // coroutine can't wait in the destructor, so the scope must be joined before it ends
+    class Scope {
+    public:
+        class JoinAwaiter {
+        public:
+            explicit JoinAwaiter(Scope& scope) : scope_(scope) {
+            }
+
+            bool await_ready() {
+                return scope_.count_.load(std::memory_order_acquire) == 1;
+            }
+
+            // the reference of the owner is dropped after the continuation is set,
+            // so the last child resumes it, or nobody waits
+            bool await_suspend(std::coroutine_handle<> caller) {
+                scope_.continuation_ = caller;
+                return scope_.count_.fetch_sub(1, std::memory_order_acq_rel) != 1;
+            }
+
+            void await_resume() {
+                // no children : the reference of the owner is back, and the scope can be reused
+                scope_.count_.store(1, std::memory_order_relaxed);
+                scope_.state_.ResetAndRethrow();
+            }
+
+        private:
+            Scope& scope_;
+        };
+
+        explicit Scope(Executors::IExecutor& executor) : executor_(executor) {
+        }
+
+        // Non-copyable
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        ~Scope() noexcept {
+            assert(count_.load(std::memory_order_relaxed) == 1);
+        }
+
+        // child starts on the executor of the scope
+        void Spawn(Task<> child) {
+            count_.fetch_add(1, std::memory_order_relaxed);
+            RunChild(*this, std::move(child)).Detach();
+        }
+
+        // the awaiting coroutine is resumed by the last child, not by a blocked thread
+        JoinAwaiter Join() {
+            return JoinAwaiter(*this);
+        }
+
+        void Cancel() {
+            state_.Cancel();
+        }
+
+        [[nodiscard]] bool IsCancelled() const {
+            return state_.IsCancelled();
+        }
+
+        // for the blocking operations of the children
+        [[nodiscard]] Cancellation::StopToken GetToken() const {
+            return state_.GetToken();
+        }
+
+    private:
+        class ExitAwaiter {
+        public:
+            explicit ExitAwaiter(Scope& scope) : scope_(scope) {
+            }
+
+            bool await_ready() noexcept {
+                return false;
+            }
+
+            // the frame of the child is destroyed before the count is decremented,
+            // and the scope isn't touched after it, unless the child is the last one
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> self) noexcept {
+                Scope& scope = scope_;
+                self.destroy();
+                if (scope.count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    return scope.continuation_;
+                }
+                return std::noop_coroutine();
+            }
+
+            void await_resume() noexcept {
+            }
+
+        private:
+            Scope& scope_;
+        };
+
+        // the frame of the child is destroyed by the stopped executor before ExitAwaiter :
+        // the child leaves the scope with OperationCancelled, so Join isn't left waiting
+        class DropGuard {
+        public:
+            explicit DropGuard(Scope& scope) : scope_(&scope) {
+            }
+
+            // Non-copyable
+            DropGuard(const DropGuard&) = delete;
+            DropGuard& operator=(const DropGuard&) = delete;
+
+            ~DropGuard() {
+                if (scope_ != nullptr) {
+                    scope_->DropChild();
+                }
+            }
+
+            void Release() {
+                scope_ = nullptr;
+            }
+
+        private:
+            Scope* scope_;
+        };
+
+        void DropChild() {
+            state_.SetException(std::make_exception_ptr(Cancellation::OperationCancelled()));
+            if (count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                continuation_.resume();
+            }
+        }
+
+        static Task<> RunChild(Scope& scope, Task<> child) {
+            DropGuard guard(scope);
+            co_await Schedule(scope.executor_);
+            if (!scope.IsCancelled()) {
+                try {
+                    co_await std::move(child);
+                }
+                catch (...) {
+                    scope.state_.SetException(std::current_exception());
+                }
+            }
+            guard.Release();
+            co_await ExitAwaiter(scope);
+        }
+
+    private:
+        Executors::IExecutor& executor_;
+        ::Detail::ScopeState state_;
+
+        // children and the reference of the owner, which is dropped by Join
+        std::atomic<size_t> count_{ 1 };
+        std::coroutine_handle<> continuation_;
+    };
+
+}
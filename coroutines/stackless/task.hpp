@@ -1,62 +1,192 @@
 #pragma once
+#include "../../detail/slab_allocator.hpp"
 #include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
 
 namespace Tasks {
 
-    template <typename T>
-    class [[nodiscard]] Task {
-    public:
-        struct Promise;
+    namespace Detail {
 
-        using AnyCoroHandle = std::coroutine_handle<>;
-        using MyCoroHandle = std::coroutine_handle<Promise>;
+        class PromiseBase {
+        public:
+            // frames come from the size classes of the current thread instead of the global heap,
+            // frame freed by other thread goes back to the heap of its owner
+            static void* operator new(size_t size) {
+                return ::Detail::SlabAllocator::Allocate(size);
+            }
 
-        struct Promise {
-            auto get_return_object() {
-                // TODO
+            static void operator delete(void* ptr, size_t size) {
+                ::Detail::SlabAllocator::Deallocate(ptr, size);
             }
 
-            auto initial_suspend() noexcept {
-                // TODO
+            struct FinalAwaiter {
+                bool await_ready() noexcept {
+                    return false;
+                }
+
+                // symmetric transfer : the awaiting coroutine is resumed by the tail call, not by the nested resume,
+                // so long chains of tasks don't grow the stack (gcc makes the tail call only with optimizations)
+                template <typename Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> coro) noexcept {
+                    PromiseBase& promise = coro.promise();
+                    if (promise.continuation_) {
+                        return promise.continuation_;
+                    }
+                    if (promise.detached_) {
+                        coro.destroy();
+                    }
+                    return std::noop_coroutine();
+                }
+
+                void await_resume() noexcept {
+                }
+            };
+
+            // lazy start : the body runs only when the task is awaited or detached
+            std::suspend_always initial_suspend() noexcept {
+                return {};
             }
 
-            auto final_suspend() noexcept {
-                // TODO
+            FinalAwaiter final_suspend() noexcept {
+                return {};
             }
 
+            // nobody waits for the result of the detached task, and it can be resumed from noexcept code
+            // (e.g. the callback of the future), so its exception terminates the program,
+            // the task, that can throw, is awaited or spawned in Tasks::Scope, which keeps the exception
             void unhandled_exception() {
-                // TODO
+                if (detached_) {
+                    std::terminate();
+                }
+                exception_ = std::current_exception();
+            }
+
+            void SetContinuation(std::coroutine_handle<> continuation) {
+                continuation_ = continuation;
+            }
+
+            void SetDetached() {
+                detached_ = true;
+            }
+
+            void SetSelf(std::coroutine_handle<> self) {
+                self_ = self;
+            }
+
+            // for the task, which awaits this one
+            void SetParent(PromiseBase* parent) {
+                parent_ = parent;
+            }
+
+            // the routine of the suspended chain of tasks is dropped by the stopped executor :
+            // the detached task at the root of the chain is destroyed with the frames of the tasks it awaits,
+            // the chain with the owned root is left to the owner
+            void DestroyDetachedRoot() {
+                PromiseBase* root = this;
+                while (root->parent_ != nullptr) {
+                    root = root->parent_;
+                }
+                if (root->detached_) {
+                    root->self_.destroy();
+                }
+            }
+
+        protected:
+            void RethrowIfException() {
+                if (exception_ != nullptr) {
+                    std::rethrow_exception(exception_);
+                }
+            }
+
+        private:
+            std::coroutine_handle<> continuation_;
+            std::exception_ptr exception_;
+            std::coroutine_handle<> self_;
+            PromiseBase* parent_ = nullptr;
+            bool detached_ = false;
+        };
+
+        template <typename T>
+        class PromiseResult : public PromiseBase {
+        public:
+            void return_value(T value) {
+                value_.emplace(std::move(value));
+            }
+
+            T GetResult() {
+                RethrowIfException();
+                return std::move(*value_);
+            }
+
+        private:
+            std::optional<T> value_;
+        };
+
+        template <>
+        class PromiseResult<void> : public PromiseBase {
+        public:
+            void return_void() {
+            }
+
+            void GetResult() {
+                RethrowIfException();
             }
+        };
+
+    }
+
+    template <typename T = void>
+    class [[nodiscard]] Task {
+    public:
+        struct Promise;
+
+        using AnyCoroHandle = std::coroutine_handle<>;
+        using MyCoroHandle = std::coroutine_handle<Promise>;
 
-            void return_value(T /*value*/) {
-                // TODO
+        struct Promise : Detail::PromiseResult<T> {
+            Task get_return_object() {
+                auto coro = MyCoroHandle::from_promise(*this);
+                this->SetSelf(coro);
+                return Task(coro);
             }
         };
 
         struct Awaiter {
             bool await_ready() {
-                // TODO
+                return coro.done();
             }
 
-            void await_suspend(AnyCoroHandle /*caller*/) {
-                // TODO
+            // the awaiting coroutine is suspended and the task starts by the tail call
+            template <typename CallerPromise>
+            AnyCoroHandle await_suspend(std::coroutine_handle<CallerPromise> caller) {
+                coro.promise().SetContinuation(caller);
+                if constexpr (std::is_base_of_v<Detail::PromiseBase, CallerPromise>) {
+                    coro.promise().SetParent(&caller.promise());
+                }
+                return coro;
             }
 
             T await_resume() {
-                // TODO
+                return coro.promise().GetResult();
             }
+
+            MyCoroHandle coro;
         };
 
-        Task() {
-            // TODO
-        }
+        Task() = default;
 
-        Task(Task&&) {
-            // TODO
+        Task(Task&& other) noexcept : coro_(std::exchange(other.coro_, nullptr)) {
         }
 
-        Task& operator=(Task&&) noexcept {
-            // TODO
+        Task& operator=(Task&& other) noexcept {
+            if (this != &other) {
+                Destroy();
+                coro_ = std::exchange(other.coro_, nullptr);
+            }
+            return *this;
         }
 
         // Non-copyable
@@ -64,11 +194,34 @@ namespace Tasks {
         Task& operator=(const Task&) = delete;
 
         ~Task() noexcept {
-            // TODO
+            Destroy();
         }
 
+        // task and its frame must outlive the co_await expression
         auto operator co_await() {
-            // TODO
+            return Awaiter{ coro_ };
+        }
+
+        [[nodiscard]] bool Valid() const {
+            return (bool)coro_;
+        }
+
+        // starts the task on the current thread, the frame is destroyed by the task itself at the end
+        void Detach() && {
+            MyCoroHandle coro = std::exchange(coro_, nullptr);
+            coro.promise().SetDetached();
+            coro.resume();
+        }
+
+    private:
+        explicit Task(MyCoroHandle coro) : coro_(coro) {
+        }
+
+        void Destroy() {
+            if (coro_) {
+                coro_.destroy();
+                coro_ = nullptr;
+            }
         }
 
     private:
@@ -80,4 +233,4 @@ namespace Tasks {
 template <typename T, typename... Args>
 struct std::coroutine_traits<Tasks::Task<T>, Args...> {
     using promise_type = typename Tasks::Task<T>::Promise;
-};
\ No newline at end of file
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace Detail {
+
+    // parked thread sleeps in the futex until somebody notifies it
+    // raw futex instead of atomic wait, because atomic wait has no timeout
+    class FutexParker {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        [[nodiscard]] bool IsNotified() const {
+            return wakeup_.load(std::memory_order_acquire) != 0;
+        }
+
+        void Wait() {
+            while (!IsNotified()) {
+                FutexWait(nullptr);
+            }
+        }
+
+        // return false if deadline has come, but nobody has notified
+        bool WaitUntil(Clock::time_point deadline) {
+            while (!IsNotified()) {
+                auto now = Clock::now();
+                if (now >= deadline) {
+                    return false;
+                }
+
+                auto timeout_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now).count();
+                timespec timeout{ (time_t)(timeout_ns / 1'000'000'000), (long)(timeout_ns % 1'000'000'000) };
+                FutexWait(&timeout);
+            }
+            return true;
+        }
+
+        void Notify() {
+            wakeup_.store(1, std::memory_order_release);
+            syscall(SYS_futex, (uint32_t*)&wakeup_, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+        }
+
+        // only for parked thread after wake up
+        void Reset() {
+            wakeup_.store(0, std::memory_order_relaxed);
+        }
+
+    private:
+        void FutexWait(const timespec* timeout) {
+            syscall(SYS_futex, (uint32_t*)&wakeup_, FUTEX_WAIT_PRIVATE, 0, timeout, nullptr, 0);
+        }
+
+    private:
+        std::atomic<uint32_t> wakeup_{ 0 };
+    };
+
+}
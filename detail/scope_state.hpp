@@ -0,0 +1,51 @@
+#pragma once
+
+#include "../cancellation/stop_token.hpp"
+#include <atomic>
+#include <exception>
+#include <utility>
+
+namespace Detail {
+
+    // stop source and the first exception of the children of a scope
+    class ScopeState {
+    public:
+        // children check it and stop, not started children are skipped,
+        // blocked channel operations with the token of the scope are resumed
+        void Cancel() {
+            stop_source_.RequestStop();
+        }
+
+        [[nodiscard]] bool IsCancelled() const {
+            return stop_source_.StopRequested();
+        }
+
+        [[nodiscard]] Cancellation::StopToken GetToken() const {
+            return stop_source_.GetToken();
+        }
+
+        // only the first exception is kept, siblings are cancelled
+        void SetException(std::exception_ptr exception) {
+            if (!has_exception_.test_and_set(std::memory_order_acq_rel)) {
+                exception_ = std::move(exception);
+            }
+            Cancel();
+        }
+
+        // after all children are joined : the state is cleared for the next children of the scope,
+        // and the first exception of the joined ones is rethrown
+        void ResetAndRethrow() {
+            stop_source_ = Cancellation::StopSource();
+            has_exception_.clear(std::memory_order_relaxed);
+            if (exception_ != nullptr) {
+                std::rethrow_exception(std::exchange(exception_, nullptr));
+            }
+        }
+
+    private:
+        Cancellation::StopSource stop_source_;
+        std::atomic_flag has_exception_{ false };
+        std::exception_ptr exception_;
+    };
+
+}
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+namespace Detail {
+
+    // size-class slab allocator with one heap for every thread
+    //
+    // owner thread allocates and frees blocks of its heap without atomics,
+    // other threads collect freed blocks of one owner in the local batch and push the whole batch
+    // into the remote free list of the owner heap by one CAS,
+    // owner takes the whole remote free list at once, when its own free list is empty
+    //
+    // heap of the finished thread is abandoned and adopted by the next new thread,
+    // so slabs are never returned to the system, but memory doesn't grow with count of threads
+    class SlabAllocator {
+        struct FreeBlock {
+            FreeBlock* next;
+        };
+
+        struct Heap;
+
+        // slabs are aligned by their size, so the slab of the block is found by the mask
+        struct alignas(64) Slab {
+            Heap* owner;
+            size_t size_class;
+            Slab* next;
+        };
+
+    public:
+        constexpr static size_t kMaxSize = 2048;
+        constexpr static size_t kMaxAlignment = 64;
+
+        static void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+            if (size > kMaxSize || alignment > kMaxAlignment) {
+                return ::operator new(size, std::align_val_t(alignment));
+            }
+
+            size_t size_class = GetSizeClass(size);
+            if (local_heap_.heap == nullptr) [[unlikely]] {
+                if (local_heap_.exited) {
+                    return AllocateAfterExit(size_class);
+                }
+                AdoptHeap();
+            }
+            Heap& heap = *local_heap_.heap;
+
+            FreeBlock* block = heap.free_lists[size_class];
+            if (block == nullptr) {
+                block = Refill(heap, size_class);
+            }
+            heap.free_lists[size_class] = block->next;
+            return block;
+        }
+
+        // size and alignment must be the same as in Allocate
+        static void Deallocate(void* ptr, size_t size, size_t alignment = alignof(std::max_align_t)) {
+            if (size > kMaxSize || alignment > kMaxAlignment) {
+                ::operator delete(ptr, std::align_val_t(alignment));
+                return;
+            }
+
+            auto* block = (FreeBlock*)ptr;
+            auto* slab = (Slab*)((uintptr_t)ptr & ~(uintptr_t)(kSlabSize - 1));
+            Heap* owner = slab->owner;
+
+            if (owner == local_heap_.heap) {
+                block->next = owner->free_lists[slab->size_class];
+                owner->free_lists[slab->size_class] = block;
+                return;
+            }
+
+            RemoteBatch& batch = local_heap_.remote_batches[slab->size_class];
+            if (batch.owner != owner) {
+                Flush(batch, slab->size_class);
+                batch.owner = owner;
+                batch.tail = block;
+            }
+            block->next = batch.head;
+            batch.head = block;
+            // nobody flushes the batch after the holder of the finished thread is destroyed
+            if (++batch.count == kRemoteBatchSize || local_heap_.exited) {
+                Flush(batch, slab->size_class);
+            }
+        }
+
+    private:
+        constexpr static size_t kSlabSize = 64 * 1024;
+        constexpr static size_t kMinSize = 32;
+
+        // 32, 64, 128, 256, 512, 1024, 2048
+        constexpr static size_t kSizeClassesCount = 7;
+
+        // blocks of the other thread wait in the batch till it is full, the owner changes or the thread finishes
+        constexpr static size_t kRemoteBatchSize = 32;
+
+        struct alignas(64) Heap {
+            // only for owner
+            FreeBlock* free_lists[kSizeClassesCount] = {};
+            Slab* slabs = nullptr;
+
+            // alignas(64) to avoid extra cache synchronizations between owner and other threads
+            alignas(64) std::atomic<FreeBlock*> remote_free_lists[kSizeClassesCount] = {};
+
+            Heap* next_abandoned = nullptr; // guarded by Registry::mutex
+        };
+
+        struct Registry {
+            std::mutex mutex;
+            Heap* abandoned = nullptr;
+        };
+
+        // freed blocks of one other heap
+        struct RemoteBatch {
+            Heap* owner = nullptr;
+            FreeBlock* head = nullptr;
+            FreeBlock* tail = nullptr;
+            size_t count = 0;
+        };
+
+        // destructors of the other thread_locals can allocate and free blocks after it,
+        // then the thread has no heap, and its blocks are freed as the blocks of the other thread
+        struct LocalHeapHolder {
+            Heap* heap = nullptr;
+            RemoteBatch remote_batches[kSizeClassesCount];
+            bool exited = false;
+
+            ~LocalHeapHolder() {
+                exited = true;
+                for (size_t size_class = 0; size_class < kSizeClassesCount; ++size_class) {
+                    Flush(remote_batches[size_class], size_class);
+                }
+
+                if (heap == nullptr) {
+                    return;
+                }
+
+                auto& registry = GetRegistry();
+                std::lock_guard guard(registry.mutex);
+                heap->next_abandoned = registry.abandoned;
+                registry.abandoned = heap;
+                // the heap can be adopted by the next thread at once
+                heap = nullptr;
+            }
+        };
+
+        static size_t GetSizeClass(size_t size) {
+            size_t size_class = 0;
+            for (size_t class_size = kMinSize; class_size < size; class_size *= 2) {
+                ++size_class;
+            }
+            return size_class;
+        }
+
+        static void AdoptHeap() {
+            auto& registry = GetRegistry();
+            std::lock_guard guard(registry.mutex);
+            if (registry.abandoned != nullptr) {
+                local_heap_.heap = registry.abandoned;
+                registry.abandoned = registry.abandoned->next_abandoned;
+            }
+            else {
+                local_heap_.heap = new Heap;
+            }
+        }
+
+        // the finished thread takes the block from the abandoned heap, which stays abandoned,
+        // nobody else touches the free lists of the abandoned heap without the registry mutex
+        static void* AllocateAfterExit(size_t size_class) {
+            auto& registry = GetRegistry();
+            std::lock_guard guard(registry.mutex);
+            if (registry.abandoned == nullptr) {
+                registry.abandoned = new Heap;
+            }
+            Heap& heap = *registry.abandoned;
+
+            FreeBlock* block = heap.free_lists[size_class];
+            if (block == nullptr) {
+                block = Refill(heap, size_class);
+            }
+            heap.free_lists[size_class] = block->next;
+            return block;
+        }
+
+        // never destroyed : blocks can be freed by threads that finish after static destructors
+        static Registry& GetRegistry() {
+            static auto* registry = new Registry;
+            return *registry;
+        }
+
+        static void Flush(RemoteBatch& batch, size_t size_class) {
+            if (batch.head == nullptr) {
+                return;
+            }
+
+            auto& remote_free_list = batch.owner->remote_free_lists[size_class];
+            batch.tail->next = remote_free_list.load(std::memory_order_relaxed);
+            while (!remote_free_list.compare_exchange_weak(batch.tail->next, batch.head, std::memory_order_release,
+                                                           std::memory_order_relaxed)) {
+            }
+            batch = RemoteBatch();
+        }
+
+        static FreeBlock* Refill(Heap& heap, size_t size_class) {
+            FreeBlock* remote = heap.remote_free_lists[size_class].exchange(nullptr, std::memory_order_acquire);
+            if (remote != nullptr) {
+                return remote;
+            }
+
+            auto* slab = (Slab*)std::aligned_alloc(kSlabSize, kSlabSize);
+            if (slab == nullptr) {
+                throw std::bad_alloc();
+            }
+            slab->owner = &heap;
+            slab->size_class = size_class;
+            slab->next = heap.slabs;
+            heap.slabs = slab;
+
+            // carve the whole slab into the free list
+            size_t block_size = kMinSize << size_class;
+            char* begin = (char*)slab + sizeof(Slab);
+            size_t blocks_count = (kSlabSize - sizeof(Slab)) / block_size;
+
+            FreeBlock* free_list = nullptr;
+            for (size_t i = blocks_count; i > 0; --i) {
+                auto* block = (FreeBlock*)(begin + (i - 1) * block_size);
+                block->next = free_list;
+                free_list = block;
+            }
+            return free_list;
+        }
+
+    private:
+        static thread_local LocalHeapHolder local_heap_;
+    };
+
+    inline thread_local SlabAllocator::LocalHeapHolder SlabAllocator::local_heap_;
+
+}
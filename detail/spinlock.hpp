@@ -31,8 +31,10 @@ namespace Detail {
 
             // twice unlock - UB
             void Unlock() {
-                spinlock_.Release(this);
+                // before Release : the next owner can resume the fiber, which owns this guard,
+                // and then the guard is destroyed
                 released_ = true;
+                spinlock_.Release(this);
             }
 
         private:
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "../executors/iexecutor.hpp"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace Detail {
+
+    // one timer thread for all executors without their own timers (IExecutor::ExecuteAt returns false),
+    // the executors of the library have timers, so it serves only the executors of users
+    //
+    // at the deadline routine is passed to its executor by Execute,
+    // so the executor must accept routines from other threads and outlive its timers
+    class TimerThread {
+    public:
+        // never destroyed : the thread is detached and waits for timers till the process exit
+        static TimerThread& Instance() {
+            static auto* instance = new TimerThread;
+            return *instance;
+        }
+
+        void ExecuteAt(Executors::IExecutor& executor, Executors::Clock::time_point deadline,
+                       Executors::Routine* routine) {
+            std::lock_guard guard(mutex_);
+            bool is_nearest = (timers_.empty() || deadline < timers_.top().deadline);
+            timers_.push(Timer{ deadline, &executor, routine });
+            if (is_nearest) {
+                wakeup_.notify_one();
+            }
+        }
+
+    private:
+        struct Timer {
+            Executors::Clock::time_point deadline;
+            Executors::IExecutor* executor;
+            Executors::Routine* routine;
+
+            bool operator>(const Timer& other) const {
+                return deadline > other.deadline;
+            }
+        };
+
+        TimerThread() {
+            std::thread([this]() {
+                Loop();
+            }).detach();
+        }
+
+        void Loop() {
+            std::unique_lock lock(mutex_);
+            while (true) {
+                if (timers_.empty()) {
+                    wakeup_.wait(lock);
+                    continue;
+                }
+
+                // copy : timers_ can change, while the lock is released
+                auto deadline = timers_.top().deadline;
+                if (Executors::Clock::now() < deadline) {
+                    wakeup_.wait_until(lock, deadline);
+                    continue;
+                }
+
+                Timer timer = timers_.top();
+                timers_.pop();
+
+                lock.unlock();
+                timer.executor->Execute(timer.routine);
+                lock.lock();
+            }
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable wakeup_;
+        std::priority_queue<Timer, std::vector<Timer>, std::greater<>> timers_;
+    };
+
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "../intrusive/tasks/task_base.hpp"
+#include "../intrusive/structures/queue.hpp"
+#include "slab_allocator.hpp"
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <optional>
+
+namespace Detail {
+
+    // hierarchical timer wheel : kLevelsCount levels of kSlotsCount slots,
+    // slot of the level l covers kSlotsCount^l ticks
+    //
+    // timer is inserted in O(1), and on the way to its deadline it moves down at most once per level,
+    // the next expiration is found by the occupied bitmaps without going through empty slots
+    //
+    // not thread-safe, only for the owner
+    class TimerWheel {
+    public:
+        struct Timer : Intrusive::SinglyDirectedListNode {
+            uint64_t deadline;
+            Intrusive::TaskBase* routine;
+            // routine is Executors::TimerRoutine, it must fire before it is run
+            bool cancellable;
+
+            Timer(uint64_t deadline, Intrusive::TaskBase* routine, bool cancellable = false)
+                : deadline(deadline), routine(routine), cancellable(cancellable) {
+            }
+
+            static void* operator new(size_t size) {
+                return SlabAllocator::Allocate(size);
+            }
+
+            static void operator delete(void* ptr, size_t size) {
+                SlabAllocator::Deallocate(ptr, size);
+            }
+        };
+
+        // return false if timer is already expired, then it isn't inserted
+        bool Insert(Timer* timer) {
+            if (timer->deadline <= elapsed_) {
+                return false;
+            }
+
+            // too far timers wait in the last level and are reinserted on the way
+            uint64_t deadline = std::min(timer->deadline, elapsed_ + kMaxDelay);
+
+            size_t level = GetLevel(deadline);
+            size_t slot = (deadline >> (level * kSlotBits)) & (kSlotsCount - 1);
+
+            auto& wheel_level = levels_[level];
+            timer->next = wheel_level.slots[slot];
+            wheel_level.slots[slot] = timer;
+            wheel_level.occupied |= ((uint64_t)1 << slot);
+            ++size_;
+
+            return true;
+        }
+
+        // moves all timers with deadline <= now into expired
+        void Advance(uint64_t now, Intrusive::Queue& expired) {
+            std::optional<Expiration> expiration;
+            while ((expiration = GetNextExpiration()).has_value() && expiration->deadline <= now) {
+                auto& wheel_level = levels_[expiration->level];
+                auto* timer = (Timer*)wheel_level.slots[expiration->slot];
+                wheel_level.slots[expiration->slot] = nullptr;
+                wheel_level.occupied &= ~((uint64_t)1 << expiration->slot);
+
+                elapsed_ = std::max(elapsed_, expiration->deadline);
+
+                // timers of the upper levels go down
+                while (timer != nullptr) {
+                    auto* next = (Timer*)timer->next;
+                    --size_;
+                    if (timer->deadline <= now || !Insert(timer)) {
+                        expired.Push(timer);
+                    }
+                    timer = next;
+                }
+            }
+
+            elapsed_ = std::max(elapsed_, now);
+        }
+
+        // lower bound of the nearest deadline
+        [[nodiscard]] std::optional<uint64_t> NextDeadline() const {
+            auto expiration = GetNextExpiration();
+            if (!expiration.has_value()) {
+                return std::nullopt;
+            }
+            return expiration->deadline;
+        }
+
+        // moves all timers into timers, expired or not
+        void TakeAll(Intrusive::Queue& timers) {
+            for (auto& wheel_level : levels_) {
+                for (auto& slot : wheel_level.slots) {
+                    while (slot != nullptr) {
+                        auto* timer = slot;
+                        slot = slot->next;
+                        timers.Push(timer);
+                    }
+                }
+                wheel_level.occupied = 0;
+            }
+            size_ = 0;
+        }
+
+        [[nodiscard]] bool Empty() const {
+            return size_ == 0;
+        }
+
+    private:
+        constexpr static size_t kSlotBits = 6;
+        constexpr static size_t kSlotsCount = (size_t)1 << kSlotBits;
+        constexpr static size_t kLevelsCount = 6;
+        // the last level slot of the farthest timer must not wrap around to the current one
+        constexpr static uint64_t kMaxDelay = ((uint64_t)1 << (kSlotBits * kLevelsCount)) -
+                                              ((uint64_t)1 << (kSlotBits * (kLevelsCount - 1)));
+
+        struct Expiration {
+            size_t level;
+            size_t slot;
+            // start of the slot
+            uint64_t deadline;
+        };
+
+        struct Level {
+            uint64_t occupied = 0;
+            std::array<Intrusive::SinglyDirectedListNode*, kSlotsCount> slots{};
+        };
+
+        // level where lower level slots can't distinguish deadline from elapsed_
+        [[nodiscard]] size_t GetLevel(uint64_t deadline) const {
+            uint64_t masked = (elapsed_ ^ deadline) | (kSlotsCount - 1);
+            size_t significant = 63 - std::countl_zero(masked);
+            return std::min(significant / kSlotBits, kLevelsCount - 1);
+        }
+
+        // timers of the lower level always expire earlier, than timers of the upper one
+        [[nodiscard]] std::optional<Expiration> GetNextExpiration() const {
+            for (size_t level = 0; level < kLevelsCount; ++level) {
+                uint64_t occupied = levels_[level].occupied;
+                if (occupied == 0) {
+                    continue;
+                }
+
+                size_t slot_shift = level * kSlotBits;
+                size_t position = (elapsed_ >> slot_shift) & (kSlotsCount - 1);
+                size_t slot = (position + std::countr_zero(std::rotr(occupied, (int)position))) % kSlotsCount;
+
+                uint64_t level_range = (uint64_t)1 << (slot_shift + kSlotBits);
+                uint64_t deadline = (elapsed_ & ~(level_range - 1)) + ((uint64_t)slot << slot_shift);
+                if (slot < position) {
+                    deadline += level_range;
+                }
+                return Expiration{ level, slot, deadline };
+            }
+            return std::nullopt;
+        }
+
+    private:
+        std::array<Level, kLevelsCount> levels_;
+        uint64_t elapsed_ = 0;
+        size_t size_ = 0;
+    };
+
+}
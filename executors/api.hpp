@@ -2,14 +2,43 @@
 
 #include "iexecutor.hpp"
 #include "../intrusive/tasks/default_task.hpp"
+#include "../intrusive/tasks/inline_task.hpp"
+#include <type_traits>
 
 namespace Executors {
 
+    // the routine always keeps its own copy of the functor : lvalues are copied, rvalues are moved
+    template <typename Functor>
+    Routine* MakeRoutine(Functor&& task) {
+        using Task = std::decay_t<Functor>;
+        // small functors go to the inline task cell
+        if constexpr (Intrusive::kFitsInlineTask<Task>) {
+            return new Intrusive::InlineTask<Task>(std::forward<Functor>(task));
+        }
+        else {
+            return new Intrusive::DefaultTask<Task>(std::forward<Functor>(task), /*is_allocated_on_heap=*/true);
+        }
+    }
+
     template <typename Functor>
     void Execute(IExecutor& executor, Functor&& task) {
-        auto* intrusive_task = new Intrusive::DefaultTask<Functor>(std::forward<Functor>(task),
-                /*is_allocated_on_heap=*/true);
-        executor.Execute(intrusive_task);
+        executor.Execute(MakeRoutine(std::forward<Functor>(task)));
+    }
+
+    // return false if executor has no timers
+    template <typename Functor>
+    bool ExecuteAt(IExecutor& executor, Clock::time_point deadline, Functor&& task) {
+        Routine* routine = MakeRoutine(std::forward<Functor>(task));
+        if (!executor.ExecuteAt(deadline, routine)) {
+            routine->Discard();
+            return false;
+        }
+        return true;
+    }
+
+    template <typename Functor>
+    bool ExecuteAfter(IExecutor& executor, Clock::duration delay, Functor&& task) {
+        return ExecuteAt(executor, Clock::now() + delay, std::forward<Functor>(task));
     }
 
 }
@@ -1,10 +1,46 @@
 #pragma once
 
 #include "../intrusive/tasks/task_base.hpp"
+#include "../intrusive/structures/queue.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 
 namespace Executors {
 
     using Routine = Intrusive::TaskBase;
+    using Clock = std::chrono::steady_clock;
+
+    class IExecutor;
+
+    // routine of the timer, that can become useless before its deadline (e.g. the timeout of the wait,
+    // that has succeeded), the executor at the deadline and the canceller race for the single state
+    class TimerRoutine : public Routine {
+    public:
+        // for the executor at the deadline and for Run, the winner of the race may call it again
+        // return false if the timer is cancelled, then the routine is only discarded
+        bool TryFire() {
+            uint8_t state = kPending;
+            return state_.compare_exchange_strong(state, kFired, std::memory_order_acq_rel) || state == kFired;
+        }
+
+        // return false if the timer has already fired
+        // the executor, which counts the timer as pending, is released, then the routine may be freed at once
+        bool TryCancel();
+
+        // for ExecuteTimerAt, before the timer is published
+        void SetOwner(IExecutor* owner) {
+            owner_ = owner;
+        }
+
+    private:
+        static const uint8_t kPending = 0;
+        static const uint8_t kFired = 1;
+        static const uint8_t kCancelled = 2;
+
+        std::atomic<uint8_t> state_{ kPending };
+        IExecutor* owner_ = nullptr;
+    };
 
     class IExecutor {
     public:
@@ -14,6 +50,59 @@ namespace Executors {
 
         // scheduling after yield may differ
         virtual void YieldExecute(Routine* routine) = 0;
+
+        // queue must contain only routines
+        // executors can override it to schedule all routines at once
+        virtual void ExecuteBatch(Intrusive::Queue&& routines) {
+            Routine* routine;
+            while ((routine = (Routine*)routines.TryPop()) != nullptr) {
+                Execute(routine);
+            }
+        }
+
+        // hint : routine continues the work of the current routine (e.g. the batch of the strand),
+        // so executor may run it next on the current thread, while its data is still in the cache
+        virtual void ExecuteNext(Routine* routine) {
+            Execute(routine);
+        }
+
+        // optional capability : routine runs not earlier than deadline
+        // return false if executor has no timers, then routine is not taken
+        virtual bool ExecuteAt(Clock::time_point deadline, Routine* routine) {
+            (void)deadline;
+            (void)routine;
+            return false;
+        }
+
+        bool ExecuteAfter(Clock::duration delay, Routine* routine) {
+            return ExecuteAt(Clock::now() + delay, routine);
+        }
+
+        // optional capability : as ExecuteAt, but the cancelled timer isn't run and stops to hold the executor busy
+        // (e.g. WaitIdle) at once, executor without this capability runs it at the deadline and Run sees TryFire fail
+        virtual bool ExecuteTimerAt(Clock::time_point deadline, TimerRoutine* routine) {
+            return ExecuteAt(deadline, routine);
+        }
+
+    protected:
+        friend TimerRoutine;
+
+        // the timer taken by ExecuteTimerAt with SetOwner(this) is cancelled, it is called once for the timer
+        virtual void ReleaseTimer() {
+        }
     };
 
+    inline bool TimerRoutine::TryCancel() {
+        // the routine can be freed by the executor right after the state is changed
+        IExecutor* owner = owner_;
+        uint8_t state = kPending;
+        if (!state_.compare_exchange_strong(state, kCancelled, std::memory_order_acq_rel)) {
+            return false;
+        }
+        if (owner != nullptr) {
+            owner->ReleaseTimer();
+        }
+        return true;
+    }
+
 }
\ No newline at end of file
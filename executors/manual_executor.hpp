@@ -2,10 +2,23 @@
 
 #include "iexecutor.hpp"
 #include "../intrusive/structures/queue.hpp"
+#include "../detail/parker.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <optional>
+#include <queue>
+#include <vector>
 
 namespace Executors {
     // single-threaded executor
+    //
+    // other threads submit only through Post, it goes to the lock-free inbox,
+    // which is moved to the queue at the start of RunAtMost, RunBatch and WaitIdle
+    //
+    // timers are kept in the heap of deadlines and moved to the queue by the same calls, when they expire,
+    // so nothing is submitted from the timer thread
     class ManualExecutor : public IExecutor {
     public:
         void Execute(Routine* routine) override {
@@ -17,15 +30,56 @@ namespace Executors {
             Execute(routine);
         }
 
+        void ExecuteBatch(Intrusive::Queue&& routines) override {
+            queue_size_ += routines.Size();
+            tasks_queue_.PushQueue(std::move(routines));
+        }
+
+        bool ExecuteAt(Clock::time_point deadline, Routine* routine) override {
+            timers_.push(Timer{ deadline, timers_sequence_++, routine, false });
+            ++pending_timers_;
+            return true;
+        }
+
+        // the cancelled timer stops to hold WaitIdle at once, it is dropped from the heap at the deadline
+        bool ExecuteTimerAt(Clock::time_point deadline, TimerRoutine* routine) override {
+            routine->SetOwner(this);
+            timers_.push(Timer{ deadline, timers_sequence_++, routine, true });
+            ++pending_timers_;
+            return true;
+        }
+
+        // thread-safe, wakes up WaitPosted and WaitIdle
+        void Post(Routine* routine) {
+            Intrusive::SinglyDirectedListNode* head = inbox_head_.load(std::memory_order_relaxed);
+            do {
+                routine->next = head;
+            } while (!inbox_head_.compare_exchange_weak(head, routine, std::memory_order_release,
+                                                        std::memory_order_relaxed));
+            // only the first post into the empty inbox can find the loop asleep,
+            // pairs with the fence in SleepUntilPosted : either the loop sees the routine, or we see it asleep
+            if (head == nullptr) {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (sleeping_.load(std::memory_order_acquire)) {
+                    inbox_parker_.Notify();
+                }
+            }
+        }
+
+        // blocks until something is posted, for the loop that has nothing to run
+        void WaitPosted() {
+            while (inbox_head_.load(std::memory_order_acquire) == nullptr) {
+                SleepUntilPosted(std::nullopt);
+            }
+        }
+
         size_t RunAtMost(size_t limit) {
+            TakePosted();
+            TakeExpired();
             size_t result = std::min(queue_size_, limit);
             for (size_t i = 0; i < result; ++i) {
                 auto* routine = (Routine*)tasks_queue_.TryPop();
-                bool need_to_delete = routine->AllocatedOnHeap();
-                routine->Run();
-                if (need_to_delete) {
-                    routine->Discard();
-                }
+                routine->RunAndDiscard();
             }
             queue_size_ -= result;
             return result;
@@ -35,38 +89,166 @@ namespace Executors {
             return (RunAtMost(1) == 1);
         }
 
+        // the whole queue is swapped out and run, routines submitted on the way are left for the next batch
+        size_t RunBatch() {
+            TakePosted();
+            TakeExpired();
+            Intrusive::Queue batch;
+            batch.PushQueue(std::move(tasks_queue_));
+            size_t result = queue_size_;
+            queue_size_ = 0;
+
+            Routine* routine;
+            while ((routine = (Routine*)batch.TryPop()) != nullptr) {
+                routine->RunAndDiscard();
+            }
+            return result;
+        }
+
         size_t Drain() {
-            return RunAtMost(queue_size_);
+            return RunBatch();
         }
 
+        // batch after batch, until there is nothing to run,
+        // the thread sleeps till the nearest deadline or the next Post, while timers are pending
         size_t WaitIdle() {
             size_t result = 0;
-            while (RunNext()) {
-                ++result;
+            while (true) {
+                size_t count = RunBatch();
+                result += count;
+                if (count != 0) {
+                    continue;
+                }
+                if (pending_timers_ == 0) {
+                    return result;
+                }
+                SleepUntilPosted(timers_.top().deadline);
             }
-            return result;
         }
 
+        // posted routines are counted after they are moved to the queue
         [[nodiscard]] size_t TaskCount() const {
             return queue_size_;
         }
 
         [[nodiscard]] bool HasTasks() const {
-            return (queue_size_ == 0);
+            return (queue_size_ != 0);
+        }
+
+        // timers, that are neither expired nor cancelled
+        [[nodiscard]] size_t TimersCount() const {
+            return pending_timers_;
         }
 
         ~ManualExecutor() noexcept override {
+            TakePosted();
             Routine* routine;
             while ((routine = (Routine*)tasks_queue_.TryPop()) != nullptr) {
                 if (routine->AllocatedOnHeap()) {
                     routine->Discard();
                 }
             }
+            while (!timers_.empty()) {
+                routine = timers_.top().routine;
+                timers_.pop();
+                if (routine->AllocatedOnHeap()) {
+                    routine->Discard();
+                }
+            }
+        }
+
+    protected:
+        // single-threaded, the timer is cancelled by the routine of this executor
+        void ReleaseTimer() override {
+            --pending_timers_;
+        }
+
+    private:
+        struct Timer {
+            Clock::time_point deadline;
+            // timers with the same deadline expire in the order of submission
+            uint64_t sequence;
+            Routine* routine;
+            bool cancellable;
+
+            bool operator>(const Timer& other) const {
+                return deadline > other.deadline || (deadline == other.deadline && sequence > other.sequence);
+            }
+        };
+
+        // the cancelled timer is discarded, it isn't counted in pending_timers_ already
+        void TakeExpired() {
+            if (timers_.empty()) {
+                return;
+            }
+            auto now = Clock::now();
+            while (!timers_.empty() && timers_.top().deadline <= now) {
+                Timer timer = timers_.top();
+                timers_.pop();
+
+                if (timer.cancellable && !((TimerRoutine*)timer.routine)->TryFire()) {
+                    if (timer.routine->AllocatedOnHeap()) {
+                        timer.routine->Discard();
+                    }
+                    continue;
+                }
+                --pending_timers_;
+                tasks_queue_.Push(timer.routine);
+                ++queue_size_;
+            }
+        }
+
+        // Post wakes up the loop only if it sleeps, so the posts into the busy loop don't pay for the futex,
+        // the late Notify of the previous sleep only wakes up the loop for nothing
+        void SleepUntilPosted(std::optional<Clock::time_point> deadline) {
+            inbox_parker_.Reset();
+            sleeping_.store(true, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (inbox_head_.load(std::memory_order_relaxed) == nullptr) {
+                if (deadline) {
+                    inbox_parker_.WaitUntil(*deadline);
+                }
+                else {
+                    inbox_parker_.Wait();
+                }
+            }
+            sleeping_.store(false, std::memory_order_relaxed);
+        }
+
+        // the inbox is the stack, so it is reversed into the order of posting
+        void TakePosted() {
+            if (inbox_head_.load(std::memory_order_relaxed) == nullptr) {
+                return;
+            }
+            auto* head = inbox_head_.exchange(nullptr, std::memory_order_acquire);
+
+            Intrusive::SinglyDirectedListNode* tail = head;
+            Intrusive::SinglyDirectedListNode* reversed = nullptr;
+            size_t count = 0;
+            while (head != nullptr) {
+                auto* next = head->next;
+                head->next = reversed;
+                reversed = head;
+                head = next;
+                ++count;
+            }
+
+            Intrusive::Queue posted(reversed, tail, count);
+            queue_size_ += count;
+            tasks_queue_.PushQueue(std::move(posted));
         }
 
     private:
         Intrusive::Queue tasks_queue_;
         size_t queue_size_ = 0;
+
+        std::atomic<Intrusive::SinglyDirectedListNode*> inbox_head_{ nullptr };
+        Detail::FutexParker inbox_parker_;
+        std::atomic<bool> sleeping_{ false };
+
+        std::priority_queue<Timer, std::vector<Timer>, std::greater<>> timers_;
+        uint64_t timers_sequence_ = 0;
+        size_t pending_timers_ = 0;
     };
 
 }
@@ -0,0 +1,414 @@
+#pragma once
+
+#include "iexecutor.hpp"
+#include "../intrusive/structures/queue.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <queue>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace Executors {
+
+    struct SimulationStats {
+        // routines run
+        uint64_t steps_count = 0;
+
+        // where routines were taken from
+        uint64_t lifo_slot_count = 0;
+        uint64_t local_queue_count = 0;
+        uint64_t global_queue_count = 0;
+        uint64_t steal_successes_count = 0;
+
+        // halves of the full local queue moved to the global queue
+        uint64_t overflow_spills_count = 0;
+
+        size_t max_global_queue_size = 0;
+        size_t max_local_queue_size = 0;
+
+        // expired timers, which were pushed to the local queues
+        uint64_t fired_timers_count = 0;
+    };
+
+    // single-threaded executor, which replays the scheduling of the thread pool by N virtual workers :
+    // local queues, the LIFO slots, the global queue, spills and steals are modelled,
+    // and every decision (which worker makes the step, fairness checks, victims) comes from the seeded PRNG
+    //
+    // the same seed and the same routines give the same order of runs,
+    // so an interleaving, found by the search over seeds, can be replayed
+    //
+    // routines are run by the caller of RunNext, like in the ManualExecutor,
+    // Execute called from the routine goes to the local queue of the virtual worker, which runs it
+    //
+    // timers use the virtual clock, so they don't depend on the speed of the machine :
+    // every step takes kStepDuration, and the idle simulation jumps to the nearest deadline,
+    // the delay of the timer is counted from the real now and rounded up to milliseconds
+    class SimulationExecutor : public IExecutor {
+    public:
+        SimulationExecutor(size_t workers, uint64_t seed, size_t local_queue_size = kDefaultLocalQueueSize)
+            : workers_(std::max<size_t>(workers, 1)), local_queue_size_(std::max<size_t>(local_queue_size, 2)),
+              random_generator_(seed) {
+        }
+
+        SimulationExecutor(const SimulationExecutor&) = delete;
+        SimulationExecutor& operator=(const SimulationExecutor&) = delete;
+
+        void Execute(Routine* routine) override {
+            ++routines_count_;
+            if (current_worker_ != kNoWorker) {
+                PushInTheLocalQueue(routine, current_worker_);
+            }
+            else {
+                PushInTheGlobalQueue(routine);
+            }
+        }
+
+        void YieldExecute(Routine* routine) override {
+            ++routines_count_;
+            PushInTheGlobalQueue(routine);
+        }
+
+        // the LIFO slot of the current virtual worker, the old LIFO routine goes to the local queue
+        void ExecuteNext(Routine* routine) override {
+            if (current_worker_ == kNoWorker) {
+                Execute(routine);
+                return;
+            }
+            ++routines_count_;
+            auto& worker = workers_[current_worker_];
+            Routine* lifo = worker.lifo_slot;
+            worker.lifo_slot = routine;
+            if (lifo != nullptr) {
+                PushInTheLocalQueue(lifo, current_worker_);
+            }
+        }
+
+        void ExecuteBatch(Intrusive::Queue&& routines) override {
+            Routine* routine;
+            while ((routine = (Routine*)routines.TryPop()) != nullptr) {
+                Execute(routine);
+            }
+        }
+
+        bool ExecuteAt(Clock::time_point deadline, Routine* routine) override {
+            PushTimer(deadline, routine, false);
+            return true;
+        }
+
+        // the cancelled timer stops to hold WaitIdle at once, it is dropped at the deadline
+        bool ExecuteTimerAt(Clock::time_point deadline, TimerRoutine* routine) override {
+            routine->SetOwner(this);
+            PushTimer(deadline, routine, true);
+            return true;
+        }
+
+        // one step of a random virtual worker, which has something to run,
+        // without routines the virtual clock jumps to the nearest deadline
+        // return false if there are neither routines nor pending timers
+        bool RunNext() {
+            TakeExpired();
+            while (routines_count_ == 0 && pending_timers_ != 0) {
+                now_ = std::max(now_, timers_.top().deadline);
+                TakeExpired();
+            }
+            if (routines_count_ == 0) {
+                return false;
+            }
+            now_ += kStepDuration;
+
+            // the LIFO slots can't be stolen, so the worker without work passes the step to the next one
+            size_t first = Random(workers_.size());
+            for (size_t i = 0; i < workers_.size(); ++i) {
+                size_t worker_id = (first + i) % workers_.size();
+                Routine* routine = TryTake(worker_id);
+                if (routine != nullptr) {
+                    Run(routine, worker_id);
+                    return true;
+                }
+            }
+
+            // unreachable : the global queue and the local queues are visible to every worker
+            return false;
+        }
+
+        size_t RunAtMost(size_t limit) {
+            size_t result = 0;
+            while (result < limit && RunNext()) {
+                ++result;
+            }
+            return result;
+        }
+
+        // runs until there is nothing to run, including routines scheduled on the way and timers
+        size_t WaitIdle() {
+            return RunAtMost(SIZE_MAX);
+        }
+
+        [[nodiscard]] size_t TaskCount() const {
+            return routines_count_;
+        }
+
+        // timers, that are neither expired nor cancelled
+        [[nodiscard]] size_t TimersCount() const {
+            return pending_timers_;
+        }
+
+        // time passed since the start of the simulation
+        [[nodiscard]] Clock::duration VirtualTime() const {
+            return now_;
+        }
+
+        [[nodiscard]] size_t WorkersCount() const {
+            return workers_.size();
+        }
+
+        // id of the virtual worker, which runs the current routine, -1 outside of the routines
+        [[nodiscard]] int CurrentWorker() const {
+            return current_worker_ == kNoWorker ? -1 : (int)current_worker_;
+        }
+
+        [[nodiscard]] const SimulationStats& GetStats() const {
+            return stats_;
+        }
+
+        ~SimulationExecutor() noexcept override {
+            Discard(global_queue_);
+            for (auto& worker : workers_) {
+                for (Routine* routine : worker.local_queue) {
+                    if (routine->AllocatedOnHeap()) {
+                        routine->Discard();
+                    }
+                }
+                if (worker.lifo_slot != nullptr && worker.lifo_slot->AllocatedOnHeap()) {
+                    worker.lifo_slot->Discard();
+                }
+            }
+            while (!timers_.empty()) {
+                Routine* routine = timers_.top().routine;
+                timers_.pop();
+                if (routine->AllocatedOnHeap()) {
+                    routine->Discard();
+                }
+            }
+        }
+
+    protected:
+        void ReleaseTimer() override {
+            --pending_timers_;
+        }
+
+    private:
+        struct VirtualWorker {
+            Routine* lifo_slot = nullptr;
+            // the owner takes the newest routine from the back, like from the bottom of the Chase-Lev deque,
+            // spills and steals take the oldest ones from the front
+            std::deque<Routine*> local_queue;
+
+            // counts how many routines were launched in a row through the lifo slot
+            size_t lifo_routines_count = 0;
+        };
+
+        // the same constants as in the thread pool, so the simulation makes the same choices
+        constexpr static size_t kDefaultLocalQueueSize = 1024;
+        constexpr static size_t kMaxLIFORoutinesCount = 20;
+        constexpr static size_t kGlobalQueueUsingConstant = 61;
+
+        constexpr static size_t kNoWorker = SIZE_MAX;
+
+        constexpr static Clock::duration kStepDuration = std::chrono::microseconds(1);
+
+        struct Timer {
+            Clock::duration deadline;
+            // timers with the same deadline expire in the order of submission
+            uint64_t sequence;
+            Routine* routine;
+            bool cancellable;
+            // the timer expires on the worker, which has set it, like in the timer wheel of the pool
+            size_t worker_id;
+
+            bool operator>(const Timer& other) const {
+                return deadline > other.deadline || (deadline == other.deadline && sequence > other.sequence);
+            }
+        };
+
+        // % instead of std::uniform_int_distribution, which differs between standard libraries
+        size_t Random(size_t bound) {
+            return (size_t)(random_generator_() % bound);
+        }
+
+        void Run(Routine* routine, size_t worker_id) {
+            --routines_count_;
+            ++stats_.steps_count;
+
+            size_t previous = current_worker_;
+            current_worker_ = worker_id;
+            routine->RunAndDiscard();
+            current_worker_ = previous;
+        }
+
+        void PushTimer(Clock::time_point deadline, Routine* routine, bool cancellable) {
+            auto delay = std::chrono::ceil<std::chrono::milliseconds>(std::max(deadline - Clock::now(),
+                                                                               Clock::duration::zero()));
+            timers_.push(Timer{ now_ + delay, timers_sequence_++, routine, cancellable, current_worker_ });
+            ++pending_timers_;
+        }
+
+        // the timer from the outside expires on the random worker
+        // the cancelled timer is discarded, it isn't counted in pending_timers_ already
+        void TakeExpired() {
+            while (!timers_.empty() && timers_.top().deadline <= now_) {
+                Timer timer = timers_.top();
+                timers_.pop();
+
+                if (timer.cancellable && !((TimerRoutine*)timer.routine)->TryFire()) {
+                    if (timer.routine->AllocatedOnHeap()) {
+                        timer.routine->Discard();
+                    }
+                    continue;
+                }
+                --pending_timers_;
+                ++routines_count_;
+                ++stats_.fired_timers_count;
+                size_t worker_id = (timer.worker_id != kNoWorker ? timer.worker_id : Random(workers_.size()));
+                PushInTheLocalQueue(timer.routine, worker_id);
+            }
+        }
+
+        void PushInTheGlobalQueue(Routine* routine) {
+            global_queue_.Push(routine);
+            stats_.max_global_queue_size = std::max(stats_.max_global_queue_size, global_queue_.Size());
+        }
+
+        // the full local queue moves its half to the global queue, like the local queue of the pool
+        void PushInTheLocalQueue(Routine* routine, size_t worker_id) {
+            auto& local_queue = workers_[worker_id].local_queue;
+            if (local_queue.size() == local_queue_size_) {
+                ++stats_.overflow_spills_count;
+                for (size_t i = 0; i < local_queue_size_ / 2; ++i) {
+                    global_queue_.Push(local_queue.front());
+                    local_queue.pop_front();
+                }
+                stats_.max_global_queue_size = std::max(stats_.max_global_queue_size, global_queue_.Size());
+            }
+            local_queue.push_back(routine);
+            stats_.max_local_queue_size = std::max(stats_.max_local_queue_size, local_queue.size());
+        }
+
+        // the order of the thread pool : the LIFO slot, the local queue, the global queue, steal,
+        // with the rare global queue first and without the LIFO slot after a long run through it
+        Routine* TryTake(size_t worker_id) {
+            auto& worker = workers_[worker_id];
+
+            if (Random(kGlobalQueueUsingConstant) == 0) {
+                if (Routine* routine = TryTakeFromTheGlobalQueue(worker_id)) {
+                    return routine;
+                }
+            }
+
+            if (worker.lifo_routines_count < kMaxLIFORoutinesCount && worker.lifo_slot != nullptr) {
+                ++worker.lifo_routines_count;
+                ++stats_.lifo_slot_count;
+                return std::exchange(worker.lifo_slot, nullptr);
+            }
+
+            if (!worker.local_queue.empty()) {
+                Routine* routine = worker.local_queue.back();
+                worker.local_queue.pop_back();
+                worker.lifo_routines_count = 0;
+                ++stats_.local_queue_count;
+                return routine;
+            }
+
+            if (Routine* routine = TryTakeFromTheGlobalQueue(worker_id)) {
+                return routine;
+            }
+
+            if (Routine* routine = TrySteal(worker_id)) {
+                return routine;
+            }
+
+            // the queues were checked and empty, so the LIFO slot may be used again
+            if (worker.lifo_slot != nullptr) {
+                worker.lifo_routines_count = 0;
+                ++stats_.lifo_slot_count;
+                return std::exchange(worker.lifo_slot, nullptr);
+            }
+            return nullptr;
+        }
+
+        // the worker grabs its share of the global queue into the local one
+        Routine* TryTakeFromTheGlobalQueue(size_t worker_id) {
+            if (global_queue_.Size() == 0) {
+                return nullptr;
+            }
+            auto& worker = workers_[worker_id];
+            worker.lifo_routines_count = 0;
+            ++stats_.global_queue_count;
+
+            auto* routine = (Routine*)global_queue_.TryPop();
+            size_t grab_size = std::min({ global_queue_.Size() / workers_.size(), local_queue_size_ / 2,
+                                          local_queue_size_ - worker.local_queue.size() });
+            for (size_t i = 0; i < grab_size; ++i) {
+                worker.local_queue.push_back((Routine*)global_queue_.TryPop());
+            }
+            return routine;
+        }
+
+        // the oldest half of the local queue of a random victim, at most the quarter of the queue size,
+        // the thief runs the oldest stolen routine and keeps the rest
+        Routine* TrySteal(size_t worker_id) {
+            size_t first = Random(workers_.size());
+            for (size_t i = 0; i < workers_.size(); ++i) {
+                size_t victim_id = (first + i) % workers_.size();
+                auto& victim = workers_[victim_id].local_queue;
+                if (victim_id == worker_id || victim.empty()) {
+                    continue;
+                }
+
+                auto& worker = workers_[worker_id];
+                worker.lifo_routines_count = 0;
+                ++stats_.steal_successes_count;
+
+                size_t steal_size = std::min((victim.size() + 1) / 2, std::max<size_t>(local_queue_size_ / 4, 1));
+                Routine* result = victim.front();
+                victim.pop_front();
+                for (size_t i = 1; i < steal_size; ++i) {
+                    worker.local_queue.push_back(victim.front());
+                    victim.pop_front();
+                }
+                return result;
+            }
+            return nullptr;
+        }
+
+        static void Discard(Intrusive::Queue& queue) {
+            Routine* routine;
+            while ((routine = (Routine*)queue.TryPop()) != nullptr) {
+                if (routine->AllocatedOnHeap()) {
+                    routine->Discard();
+                }
+            }
+        }
+
+    private:
+        std::vector<VirtualWorker> workers_;
+        const size_t local_queue_size_;
+        Intrusive::Queue global_queue_;
+
+        // in all queues and the LIFO slots
+        size_t routines_count_ = 0;
+        size_t current_worker_ = kNoWorker;
+
+        std::priority_queue<Timer, std::vector<Timer>, std::greater<>> timers_;
+        uint64_t timers_sequence_ = 0;
+        size_t pending_timers_ = 0;
+        Clock::duration now_ = Clock::duration::zero();
+
+        std::mt19937_64 random_generator_;
+        SimulationStats stats_;
+    };
+
+}
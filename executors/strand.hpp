@@ -3,7 +3,9 @@
 #include "iexecutor.hpp"
 #include <atomic>
 #include "../intrusive/structures/stack.hpp"
+#include "../detail/slab_allocator.hpp"
 #include <cassert>
+#include <utility>
 
 namespace Executors {
 
@@ -21,17 +23,27 @@ namespace Executors {
                 return false;
             }
 
+            // routines, that arrive while the batch runs, are taken in place till the drain budget is spent,
+            // then the strand goes back to the executor, so the other tasks of the worker aren't starved
             void Run() override {
-                Routine* routine;
-                while ((routine = (Routine*)stack_.TryPop()) != nullptr) {
-                    bool need_to_delete = routine->AllocatedOnHeap();
-                    routine->Run();
-                    if (need_to_delete) {
-                        routine->Discard();
+                size_t budget = strand_->drain_budget_;
+                size_t count = 0;
+                while (true) {
+                    Routine* routine;
+                    while ((routine = (Routine*)stack_.TryPop()) != nullptr) {
+                        routine->RunAndDiscard();
+                        ++count;
                     }
-                }
 
-                strand_->Unlock();
+                    if (count >= budget) {
+                        strand_->Unlock();
+                        return;
+                    }
+                    if (strand_->TryUnlock()) {
+                        return;
+                    }
+                    stack_ = strand_->TakeArrivals();
+                }
             }
 
             void Discard() override {
@@ -43,10 +55,48 @@ namespace Executors {
             Strand* strand_ = nullptr;
         };
 
+        // timer of the underlying executor, at the deadline the routine is submitted to the strand
+        class DeadlineRoutine : public Intrusive::TaskBase {
+        public:
+            DeadlineRoutine(Strand* strand, Routine* routine) : strand_(strand), routine_(routine) {
+            }
+
+            static void* operator new(size_t size) {
+                return ::Detail::SlabAllocator::Allocate(size);
+            }
+
+            static void operator delete(void* ptr, size_t size) {
+                ::Detail::SlabAllocator::Deallocate(ptr, size);
+            }
+
+            bool AllocatedOnHeap() override {
+                return true;
+            }
+
+            void Run() override {
+                strand_->Execute(std::exchange(routine_, nullptr));
+            }
+
+            // the executor is stopped before the deadline, the routine is discarded with the timer
+            void Discard() override {
+                if (routine_ != nullptr && routine_->AllocatedOnHeap()) {
+                    routine_->Discard();
+                }
+                delete this;
+            }
+
+        private:
+            Strand* strand_;
+            Routine* routine_;
+        };
+
     public:
         friend TasksBatch;
 
-        explicit Strand(IExecutor& executor) : executor_(&executor) {
+        // drain_budget : count of routines run in one submission to the executor, before new arrivals are taken
+        // through the executor again, 0 - every refill is submitted to the executor
+        explicit Strand(IExecutor& executor, size_t drain_budget = 0) : executor_(&executor),
+                                                                         drain_budget_(drain_budget) {
         }
 
         Strand() = default;
@@ -55,19 +105,55 @@ namespace Executors {
             executor_ = &executor;
         }
 
+        // only while the strand is idle
+        void SetDrainBudget(size_t drain_budget) {
+            drain_budget_ = drain_budget;
+        }
+
+        // affinity (off by default) : the batch of the idle strand is submitted through ExecuteNext,
+        // so the pool runs it next on the submitting worker, where the data of the message is hot,
+        // without it messages, that follow each other through the strands, catch up and share batches
+        // only while the strand is idle
+        void SetAffinity(bool affinity) {
+            affinity_ = affinity;
+        }
+
         void Execute(Routine* routine) override;
 
         void YieldExecute(Routine* routine) override {
             Execute(routine);
         }
 
+        void ExecuteBatch(Intrusive::Queue&& routines) override;
+
+        // timers of the underlying executor, return false if it has none
+        // the cancelled timer (ExecuteTimerAt) holds the underlying executor till the deadline
+        bool ExecuteAt(Clock::time_point deadline, Routine* routine) override {
+            auto* timer = new DeadlineRoutine(this, routine);
+            if (!executor_->ExecuteAt(deadline, timer)) {
+                delete timer;
+                return false;
+            }
+            return true;
+        }
+
     private:
         Routine* PushInStack(Routine* routine);
 
-        void Lock();
+        // top, ..., bottom must be linked through next
+        Routine* PushInStack(Routine* top, Routine* bottom);
+
+        // next : the batch is submitted as the continuation of the current routine
+        void Lock(bool next);
 
         void Unlock();
 
+        // return true if nothing has arrived, then the strand is unlocked
+        bool TryUnlock();
+
+        // the strand stays locked
+        Intrusive::Stack TakeArrivals();
+
         // make queue of 2 stacks
         static Intrusive::Stack MakeQueue(Routine* head);
 
@@ -75,6 +161,8 @@ namespace Executors {
         // because pointer occupied only last 48 bits
         static const uint64_t kClosed = ((uint64_t)1 << 63);
         IExecutor* executor_ = nullptr;
+        size_t drain_budget_ = 0;
+        bool affinity_ = false;
         std::atomic<Intrusive::SinglyDirectedListNode*> stack_head_{ nullptr };
 
         // To avoid extra allocations
@@ -94,40 +182,74 @@ namespace Executors {
     void Strand::Execute(Routine *routine) {
         Routine* result = PushInStack(routine);
         if (result == nullptr) {
-            Lock();
+            Lock(affinity_);
+        }
+    }
+
+    void Strand::ExecuteBatch(Intrusive::Queue&& routines) {
+        if (routines.Size() == 0) {
+            return;
+        }
+
+        // reverse the queue : the newest routine becomes the top of the stack
+        auto* bottom = (Routine*)routines.Front();
+        Routine* top = nullptr;
+        Routine* routine;
+        while ((routine = (Routine*)routines.TryPop()) != nullptr) {
+            routine->next = top;
+            top = routine;
+        }
+
+        Routine* result = PushInStack(top, bottom);
+        if (result == nullptr) {
+            Lock(affinity_);
         }
     }
 
     Routine *Strand::PushInStack(Routine *routine) {
-        routine->next = stack_head_.load(std::memory_order_relaxed);
+        return PushInStack(routine, routine);
+    }
+
+    Routine *Strand::PushInStack(Routine *top, Routine *bottom) {
+        bottom->next = stack_head_.load(std::memory_order_relaxed);
         Intrusive::SinglyDirectedListNode* result;
         do {
-            result = routine->next;
-        } while (!stack_head_.compare_exchange_strong(routine->next, routine, std::memory_order_release,
+            result = bottom->next;
+        } while (!stack_head_.compare_exchange_strong(bottom->next, top, std::memory_order_acq_rel,
                                                       std::memory_order_relaxed));
         return (Routine*)result;
     }
 
-    void Strand::Lock() {
-        auto* head = stack_head_.load(std::memory_order_relaxed);
-        while (!stack_head_.compare_exchange_weak(head, (Intrusive::SinglyDirectedListNode*)kClosed,
-                                                  std::memory_order_acquire,
-                                                  std::memory_order_relaxed)) {
-        }
-
-        Intrusive::Stack queue = std::move(MakeQueue((Routine*)head));
-        batch_ = std::move(TasksBatch(std::move(queue), this));
+    void Strand::Lock(bool next) {
+        batch_ = std::move(TasksBatch(TakeArrivals(), this));
 
-        executor_->Execute(&batch_);
+        if (next) {
+            executor_->ExecuteNext(&batch_);
+        }
+        else {
+            executor_->Execute(&batch_);
+        }
     }
 
     void Strand::Unlock() {
-        auto* closed = (Intrusive::SinglyDirectedListNode*)kClosed;
-        if (stack_head_.compare_exchange_strong(closed, nullptr, std::memory_order_relaxed)) {
+        if (TryUnlock()) {
             return; // queue is empty
         }
 
-        Lock();
+        // the budget is spent, so the strand doesn't take the LIFO slot again
+        Lock(false);
+    }
+
+    bool Strand::TryUnlock() {
+        auto* closed = (Intrusive::SinglyDirectedListNode*)kClosed;
+        // release : the next owner, which pushes into the empty stack, sees effects of this batch
+        return stack_head_.compare_exchange_strong(closed, nullptr, std::memory_order_release,
+                                                   std::memory_order_relaxed);
+    }
+
+    Intrusive::Stack Strand::TakeArrivals() {
+        auto* head = stack_head_.exchange((Intrusive::SinglyDirectedListNode*)kClosed, std::memory_order_acquire);
+        return std::move(MakeQueue((Routine*)head));
     }
 
 }
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Executors {
+
+    struct NumaTopology {
+        // cpus of every node
+        std::vector<std::vector<size_t>> nodes;
+
+        // reads /sys/devices/system/node, so libnuma is not needed
+        // if there is no such information, returns one node with all cpus
+        static NumaTopology ReadFromSys() {
+            NumaTopology topology;
+            std::filesystem::path nodes_path("/sys/devices/system/node");
+
+            // node ids can have gaps (e.g. offline nodes), so the directory is listed, not probed from node0
+            std::vector<std::pair<size_t, std::filesystem::path>> node_paths;
+            std::error_code error;
+            for (std::filesystem::directory_iterator it(nodes_path, error), end; !error && it != end;
+                 it.increment(error)) {
+                std::string name = it->path().filename().string();
+                if (name.size() <= 4 || name.compare(0, 4, "node") != 0 ||
+                    !std::all_of(name.begin() + 4, name.end(), [](char c) { return std::isdigit((unsigned char)c); })) {
+                    continue;
+                }
+                node_paths.emplace_back(std::stoul(name.substr(4)), it->path());
+            }
+            std::sort(node_paths.begin(), node_paths.end());
+
+            // nodes without cpus (memory-only) are skipped
+            for (auto& [node, node_path] : node_paths) {
+                std::ifstream cpulist(node_path / "cpulist");
+                std::string line;
+                std::getline(cpulist, line);
+
+                auto cpus = ParseCpuList(line);
+                if (!cpus.empty()) {
+                    topology.nodes.push_back(std::move(cpus));
+                }
+            }
+
+            if (topology.nodes.empty()) {
+                return Simulate(1, std::max(1u, std::thread::hardware_concurrency()));
+            }
+            return topology;
+        }
+
+        // splits cpus_count cpus into nodes_count nodes,
+        // it allows to check NUMA mode on the machine with one node
+        // there are no empty nodes, so there are at most cpus_count of them
+        static NumaTopology Simulate(size_t nodes_count, size_t cpus_count) {
+            NumaTopology topology;
+            cpus_count = std::max<size_t>(cpus_count, 1);
+            nodes_count = std::clamp<size_t>(nodes_count, 1, cpus_count);
+            topology.nodes.resize(nodes_count);
+            for (size_t cpu = 0; cpu < cpus_count; ++cpu) {
+                topology.nodes[cpu * nodes_count / cpus_count].push_back(cpu);
+            }
+            return topology;
+        }
+
+        // cpulist format : "0-3,8-11"
+        static std::vector<size_t> ParseCpuList(const std::string& cpulist) {
+            std::vector<size_t> cpus;
+            std::stringstream stream(cpulist);
+            std::string range;
+            while (std::getline(stream, range, ',')) {
+                if (range.empty()) {
+                    continue;
+                }
+
+                size_t dash = range.find('-');
+                size_t first = std::stoul(range.substr(0, dash));
+                size_t last = (dash == std::string::npos ? first : std::stoul(range.substr(dash + 1)));
+                for (size_t cpu = first; cpu <= last; ++cpu) {
+                    cpus.push_back(cpu);
+                }
+            }
+            return cpus;
+        }
+    };
+
+}
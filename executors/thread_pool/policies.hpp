@@ -0,0 +1,38 @@
+#pragma once
+
+#include "../../detail/waitgroup.hpp"
+#include "../../detail/parker.hpp"
+
+namespace Executors::ThreadPoolPolicies {
+
+    // policy is a struct with
+    //   kWaitIdle : if true, ThreadPool has WaitIdle
+    //   RoutinesCounter : Add(count), Done(), AllDone() and Wait() if kWaitIdle
+    //   Parker : how parked worker waits for Notify, with or without deadline :
+    //            IsNotified(), Wait(), WaitUntil(deadline) -> false on timeout, Notify(), Reset()
+
+    // counts nothing, so there are no atomics on the hot path
+    struct NoRoutinesCounter {
+        void Add(size_t) {
+        }
+
+        void Done() {
+        }
+
+        void AllDone() {
+        }
+    };
+
+    struct WithWaitIdle {
+        constexpr static bool kWaitIdle = true;
+        using RoutinesCounter = Detail::WaitGroup;
+        using Parker = Detail::FutexParker;
+    };
+
+    struct WithoutWaitIdle {
+        constexpr static bool kWaitIdle = false;
+        using RoutinesCounter = NoRoutinesCounter;
+        using Parker = Detail::FutexParker;
+    };
+
+}
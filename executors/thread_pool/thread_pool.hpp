@@ -0,0 +1,1486 @@
+#pragma once
+
+#include "../iexecutor.hpp"
+
+#include "../../intrusive/tasks/default_task.hpp"
+#include "../../intrusive/structures/queue.hpp"
+#include "../../intrusive/structures/stack.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../../lockfree/work_stealing_deque.hpp"
+#include "../../lockfree/intrusive_queue.hpp"
+
+#include "../../detail/spinlock.hpp"
+#include "../../detail/timer_wheel.hpp"
+#include "numa_topology.hpp"
+#include "worker_stats.hpp"
+#include "policies.hpp"
+
+#include <random>
+#include <pthread.h>
+#include <sched.h>
+#include <cassert>
+
+
+namespace Executors {
+
+    struct Hint {
+        // hint to push routine in the LIFO slot
+        const static uint8_t kLIFO = 0;
+
+        // hint to push routine in the local queue
+        const static uint8_t kLocalQueue = 1;
+
+        // hint to push task into the global queue
+        const static uint8_t kGlobalQueue = 2;
+
+        uint8_t hint;
+
+        explicit Hint(uint8_t hint) : hint(hint) {
+        }
+    };
+
+    struct Priority {
+        // latency-critical routines, they bypass all queued routines of lower priorities
+        const static uint8_t kHigh = 0;
+
+        // default priority, only it can use the LIFO slot
+        const static uint8_t kNormal = 1;
+
+        // bulk background routines
+        const static uint8_t kLow = 2;
+
+        const static uint8_t kPrioritiesCount = 3;
+
+        uint8_t priority;
+
+        explicit Priority(uint8_t priority) : priority(priority) {
+        }
+    };
+
+    struct ElasticLimits {
+        size_t min_workers;
+        size_t max_workers;
+
+        // if no worker has taken a routine for so long and there are queued routines,
+        // then workers are considered as blocked and one more worker is spawned
+        std::chrono::milliseconds blocking_threshold{ 10 };
+
+        // parked worker retires after so long if there are more than min_workers workers
+        std::chrono::milliseconds keep_alive{ 1000 };
+    };
+
+    // Policy : see policies.hpp
+    template <typename Policy>
+    class ThreadPool : public IExecutor {
+    private:
+        // alignas(64) to avoid extra cache synchronizations
+        struct alignas(64) Worker {
+            std::thread worker;
+
+            std::atomic_flag closed{ false };
+
+            // false if the slot has no running thread, such worker is not a steal victim
+            std::atomic<bool> active{ false };
+
+            typename Policy::Parker parker;
+
+            // written only by the worker on every take attempt, monitor sees blocked worker by it
+            std::atomic<uint64_t> ticks{ 0 };
+
+            // guarded by sleepers_spinlock_
+            std::chrono::steady_clock::time_point parked_since;
+            // worker with timers can't retire, guarded by sleepers_spinlock_
+            bool has_timers = false;
+            // set by monitor together with unpark, worker exits after wake up
+            bool retired = false;
+
+            std::random_device device;
+            std::mt19937 random_generator{ device() };
+        };
+
+        struct TakeStrategy {
+            static const uint8_t kLIFOSlot = 0;
+            static const uint8_t kLocalQueue = 1;
+            static const uint8_t kGlobalQueue = 2;
+            static const uint8_t kGrab = 3;
+
+            uint8_t steps[4];
+
+            TakeStrategy(uint8_t step1, uint8_t step2, uint8_t step3, uint8_t step4) : steps{ step1, step2,
+                                                                                              step3, step4 } {
+            }
+
+            static TakeStrategy GetDefaultTakeStrategy() {
+                return { kLIFOSlot, kLocalQueue, kGlobalQueue, kGrab };
+            }
+
+            static TakeStrategy GetGlobalQueueTakeStrategy() {
+                return { kGlobalQueue, kLIFOSlot, kLocalQueue, kGrab };
+            }
+
+            static TakeStrategy GetWithoutLIFOSlotTakeStrategy() {
+                return { kLocalQueue, kGlobalQueue, kGrab, kLIFOSlot };
+            }
+        };
+
+        // (count of unparked workers << 32) + count of searching workers
+        struct IdleState {
+            static const uint64_t kOneSearching = 1;
+            static const uint64_t kOneUnparked = ((uint64_t)1 << 32);
+
+            static size_t GetSearchingCount(uint64_t state) {
+                return (size_t)(state & (kOneUnparked - 1));
+            }
+
+            static size_t GetUnparkedCount(uint64_t state) {
+                return (size_t)(state >> 32);
+            }
+        };
+
+        // the wheel of the worker : the owner inserts and fires timers,
+        // idle workers take the overdue timers of the busy or blocked owner,
+        // so the owner locks the wheel too, but the lock is almost never contended
+        struct alignas(64) WorkerTimers {
+            constexpr static uint64_t kNoDeadline = UINT64_MAX;
+
+            std::atomic_flag locked{ false };
+            Detail::TimerWheel wheel;
+            // lower bound of the nearest deadline of the wheel, written under the lock
+            std::atomic<uint64_t> next_deadline{ kNoDeadline };
+
+            void Lock() {
+                while (locked.test_and_set(std::memory_order_acquire)) {
+                    std::this_thread::yield();
+                }
+            }
+
+            bool TryLock() {
+                return !locked.test_and_set(std::memory_order_acquire);
+            }
+
+            // seq_cst : pairs with the watcher of the timers in Park
+            void Unlock() {
+                next_deadline.store(wheel.NextDeadline().value_or(kNoDeadline), std::memory_order_seq_cst);
+                locked.clear(std::memory_order_release);
+            }
+        };
+
+        constexpr static size_t kLocalQueueSize = 1024;
+        using LocalQueue = LockFree::WorkStealingDeque<Routine, kLocalQueueSize>;
+
+    public:
+        explicit ThreadPool(size_t workers);
+
+        // NUMA-aware mode : every node has its own global queue,
+        // workers steal from the same node workers first
+        // if pin_workers, then every worker is pinned to the cpu of its node
+        ThreadPool(size_t workers, const NumaTopology& topology, bool pin_workers = true);
+
+        // elastic mode : starts with min_workers workers,
+        // monitor thread spawns compensating workers up to max_workers when all workers are blocked
+        // and retires parked ones after keep_alive
+        explicit ThreadPool(const ElasticLimits& limits);
+
+        ThreadPool(const ElasticLimits& limits, const NumaTopology& topology, bool pin_workers = true);
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        ThreadPool(ThreadPool&&) = delete;
+        ThreadPool& operator=(ThreadPool&&) = delete;
+
+        void Execute(Routine* routine) override;
+
+        void Execute(Routine* routine, Hint hint);
+
+        // routine of the lower priority runs only if there are no routines of higher priorities,
+        // except rare anti-starvation checks
+        void Execute(Routine* routine, Priority priority);
+
+        // the LIFO slot is only for Priority::kNormal, other priorities go to the local queue instead
+        void Execute(Routine* routine, Hint hint, Priority priority);
+
+        void YieldExecute(Routine* routine) override;
+
+        // the LIFO slot of the current worker, if it is called from the worker of this pool,
+        // otherwise the same as Execute
+        void ExecuteNext(Routine* routine) override;
+
+        void ExecuteBatch(Intrusive::Queue&& routines) override;
+
+        // timer goes to the wheel of the current worker,
+        // or to the timers inbox, if it is called not from the worker
+        // routine isn't finished for WaitIdle until it runs
+        bool ExecuteAt(Clock::time_point deadline, Routine* routine) override;
+
+        // the same, but the cancelled timer stops to hold WaitIdle at once and is dropped at the deadline
+        bool ExecuteTimerAt(Clock::time_point deadline, TimerRoutine* routine) override;
+
+        void WaitIdle() requires Policy::kWaitIdle;
+
+        // snapshot of workers counters, workers are not stopped,
+        // the executed routines of a busy worker are published with a lag of at most kTimersCheckInterval ticks
+        [[nodiscard]] ThreadPoolStats GetStats() const;
+
+        void Stop();
+
+        ~ThreadPool() override;
+
+    protected:
+        void ReleaseTimer() override;
+
+    private:
+        void StartWorker(size_t worker_id);
+        // to its cpu, or to the cpus of its node, if the cpu isn't allowed,
+        // the worker stays unpinned, if none of them is allowed
+        void PinWorker(size_t worker_id) const;
+        void WorkerRoutine();
+
+        // Execute routines
+        LockFree::IntrusiveQueue& GetGlobalQueue(uint8_t priority);
+        void PushRoutineInTheGlobalQueue(Routine* routine, uint8_t priority);
+        void PushRoutineInTheLocalQueue(Routine* routine, size_t queue_id, uint8_t priority);
+        void PushRoutinesInTheLocalQueue(Intrusive::Queue&& routines, size_t queue_id, uint8_t priority);
+        // return true if old LIFO routine was moved to the local queue
+        bool PushRoutineInTheLIFOSlot(Routine* routine, size_t slot_id);
+        void GrabFromLocalQueueToGlobalQueue(size_t from, uint8_t priority);
+
+        // Take routines
+        Routine* TryTake(size_t worker_id);
+        Routine* TryTake(size_t worker_id, TakeStrategy strategy, bool low_priority_first);
+        Routine* TryTakeRoutineFromLIFOSlot(size_t worker_id);
+        Routine* TryTakeRoutineFromLocalQueue(size_t worker_id, uint8_t priority);
+        Routine* TryTakeRoutineFromGlobalQueue(size_t worker_id, uint8_t priority, bool grab = true);
+        Routine* TryGrabRoutineFromLocalQueue(size_t to, uint8_t priority);
+        // random active worker of the node except to, nullptr if there is no such worker
+        LocalQueue* ChooseVictim(size_t node, size_t to, uint8_t priority);
+
+        // Timers
+        // deadline is rounded up, and now is rounded down, so timers never run early
+        uint64_t ToTicks(Clock::time_point deadline) const;
+        uint64_t NowTicks() const;
+        // moves timers from the inbox to the wheel and expired ones to the local queue,
+        // together with the overdue timers of the other workers
+        // return true if some routines were pushed
+        bool ProcessTimers(size_t worker_id);
+        // timers, which are overdue by kTimersTakeoverDelay, because their owner doesn't come to them
+        void TakeOverdueTimers(size_t worker_id, Intrusive::Queue& expired);
+        // parked worker, which watches the timers of the others, is woken up for the earlier deadline
+        void WakeTimersWatcher();
+
+        void InsertTimer(Detail::TimerWheel::Timer* timer);
+
+        // frees the timer, return nullptr if it is cancelled, then its routine is discarded
+        static Routine* FireTimer(Detail::TimerWheel::Timer* timer);
+
+        // Idle protocol
+        bool TransitionToSearching();
+        // return true if worker was the last searching one
+        bool TransitionFromSearching();
+        bool NeedToWakeUp() const;
+        void NotifyParked();
+        // return false if worker didn't park,
+        // otherwise worker is counted as searching after wake up
+        bool Park(size_t worker_id, bool searching);
+        void Unpark(size_t worker_id);
+        bool HasRoutinesToSteal() const;
+
+        // Elastic mode
+        void MonitorRoutine();
+        void RetireIdleWorkers();
+        void CompensateBlockedWorkers(std::vector<uint64_t>& last_ticks);
+
+    private:
+        // id of the worker in its pool, -1 for other threads
+        static thread_local int thread_id;
+
+        // pool of the worker, nullptr for other threads
+        static thread_local ThreadPool* current_pool;
+
+        // thread_id is shared by all pools of the policy,
+        // so the worker of another pool is an external thread for this one
+        static int CurrentWorker(const ThreadPool* pool) {
+            return (current_pool == pool ? thread_id : -1);
+        }
+
+        constexpr static size_t kMaxLIFORoutinesCount = 20;
+
+        // if rand() % kGlobalQueueUsingConstant == 0
+        // we take routine from the queue bypassing the LIFO slot
+        // it needs to complete all tasks from the global queue
+        constexpr static size_t kGlobalQueueUsingConstant = 61;
+
+        // if rand() % kLowPriorityUsingConstant == 0
+        // we look through the priorities from the lowest one
+        // it needs to complete low priority routines under the constant high priority load
+        constexpr static size_t kLowPriorityUsingConstant = 31;
+
+        // how many times searching worker tries to take routine before parking
+        constexpr static size_t kSearchingRoundsCount = 16;
+
+        // worker looks into the timers once per kTimersCheckInterval take attempts and before parking
+        constexpr static size_t kTimersCheckInterval = 32;
+
+        // ticks after the deadline, when the timer can be taken by the other worker
+        constexpr static uint64_t kTimersTakeoverDelay = 2;
+
+        // the watcher of the timers wakes up at most once per so many ticks
+        constexpr static uint64_t kTimersWatchInterval = 10;
+
+        // slots for max_workers workers, only workers_count_ of them are active
+        std::vector<Worker> workers_;
+        std::atomic<size_t> workers_count_{ 0 };
+        // written by the owner, the monitor of the elastic mode takes the routines of blocked workers
+        std::vector<std::atomic<Routine*>> lifo_slots_;
+
+        // one local queue for every priority of every worker
+        std::vector<std::array<LocalQueue, Priority::kPrioritiesCount>> local_queues_;
+
+        // one global queue for every priority of every NUMA node
+        std::vector<std::array<LockFree::IntrusiveQueue, Priority::kPrioritiesCount>> global_queues_;
+
+        std::vector<size_t> worker_nodes_;
+        std::vector<std::vector<size_t>> node_workers_;
+
+        // -1 if cpu doesn't belong to any node with workers
+        std::vector<int> cpu_nodes_;
+
+        std::vector<int> worker_cpus_;
+        bool pin_workers_;
+
+        ElasticLimits limits_;
+        std::thread monitor_;
+        std::mutex monitor_mutex_;
+        std::condition_variable monitor_cv_;
+        bool monitor_stopped_ = false; // guarded by monitor_mutex_
+
+        // idle workers search for routines, and if there are no routines, then park.
+        // producer wakes up one parked worker only if nobody searches
+        std::atomic<uint64_t> idle_state_;
+        ::Detail::QueueSpinLock sleepers_spinlock_;
+        std::vector<size_t> sleepers_; // guarded by sleepers_spinlock_
+        bool stopped_ = false; // guarded by sleepers_spinlock_
+
+        std::vector<WorkerCounters> counters_;
+
+        // one tick is one millisecond since timers_epoch_
+        Clock::time_point timers_epoch_ = Clock::now();
+        std::vector<WorkerTimers> worker_timers_;
+        // timers from not workers, any worker moves them into its wheel
+        LockFree::IntrusiveQueue timers_inbox_;
+
+        // one of the parked workers wakes up for the overdue timers of the busy or blocked workers,
+        // -1 if nobody watches
+        std::atomic<int> timers_watcher_{ -1 };
+        // deadline of the sleep of the watcher, 0 if nobody watches
+        std::atomic<uint64_t> watched_deadline_{ 0 };
+
+        // counts the number of unfinished routines
+        typename Policy::RoutinesCounter routines_wg_;
+
+        // we must maintain the invariant
+        // robbers_count_ <= workers_count_
+        std::atomic<size_t> robbers_count_{ 0 };
+
+        std::atomic_flag can_start_{ false };
+
+        // counts how many routines were launched in a row through the lifo slot
+        // if >= 20, then the next routine will not start through the lifo slot
+        std::vector<size_t> lifo_slots_routines_count_;
+    };
+
+    template <typename Policy>
+    thread_local int ThreadPool<Policy>::thread_id = -1;
+
+    template <typename Policy>
+    thread_local ThreadPool<Policy>* ThreadPool<Policy>::current_pool = nullptr;
+
+    template <typename Policy>
+    ThreadPool<Policy>::ThreadPool(size_t workers) : ThreadPool(workers, NumaTopology::Simulate(1, workers),
+                                                        /*pin_workers=*/false) {
+    }
+
+    template <typename Policy>
+    ThreadPool<Policy>::ThreadPool(size_t workers, const NumaTopology& topology,
+                           bool pin_workers) : ThreadPool(ElasticLimits{ workers, workers }, topology, pin_workers) {
+    }
+
+    template <typename Policy>
+    ThreadPool<Policy>::ThreadPool(const ElasticLimits& limits) : ThreadPool(limits,
+                                                                     NumaTopology::Simulate(1, limits.max_workers),
+                                                                     /*pin_workers=*/false) {
+    }
+
+    template <typename Policy>
+    ThreadPool<Policy>::ThreadPool(const ElasticLimits& limits, const NumaTopology& topology,
+                           bool pin_workers) : workers_(limits.max_workers),
+                                               lifo_slots_(limits.max_workers),
+                                               local_queues_(limits.max_workers),
+                                               pin_workers_(pin_workers), limits_(limits),
+                                               idle_state_(0),
+                                               counters_(limits.max_workers),
+                                               worker_timers_(limits.max_workers),
+                                               lifo_slots_routines_count_(limits.max_workers, 0) {
+        assert(limits.min_workers > 1);
+        assert(limits.min_workers <= limits.max_workers);
+        assert(!topology.nodes.empty());
+        size_t workers = limits.max_workers;
+        sleepers_.reserve(workers);
+
+        // nodes without cpus can't run workers, so they are skipped
+        std::vector<const std::vector<size_t>*> node_cpus;
+        for (auto& cpus : topology.nodes) {
+            if (!cpus.empty()) {
+                node_cpus.push_back(&cpus);
+            }
+        }
+        assert(!node_cpus.empty());
+
+        // workers are distributed over nodes round-robin, nodes without workers are skipped
+        size_t nodes_count = std::min(workers, node_cpus.size());
+        worker_cpus_.resize(workers);
+        worker_nodes_.resize(workers);
+        node_workers_.resize(nodes_count);
+        for (size_t i = 0; i < workers; ++i) {
+            size_t node = i % nodes_count;
+            auto& cpus = *node_cpus[node];
+            worker_nodes_[i] = node;
+            worker_cpus_[i] = (int)cpus[node_workers_[node].size() % cpus.size()];
+            node_workers_[node].push_back(i);
+        }
+
+        for (size_t node = 0; node < nodes_count; ++node) {
+            for (size_t cpu : *node_cpus[node]) {
+                if (cpu_nodes_.size() <= cpu) {
+                    cpu_nodes_.resize(cpu + 1, -1);
+                }
+                cpu_nodes_[cpu] = (int)node;
+            }
+        }
+        global_queues_ = std::vector<std::array<LockFree::IntrusiveQueue, Priority::kPrioritiesCount>>(nodes_count);
+
+        for (size_t i = 0; i < limits.min_workers; ++i) {
+            StartWorker(i);
+        }
+
+        can_start_.test_and_set(std::memory_order_release);
+        can_start_.notify_all();
+
+        if (limits.min_workers < limits.max_workers) {
+            monitor_ = std::thread([this] {
+                MonitorRoutine();
+            });
+        }
+    }
+
+    template <typename Policy>
+    ThreadPool<Policy>::~ThreadPool() {
+        assert(workers_.empty() || workers_[0].closed.test(std::memory_order_relaxed));
+
+        // Discard all tasks
+        Routine* routine;
+        for (auto& node_queues : global_queues_) {
+            for (auto& global_queue : node_queues) {
+                while ((routine = (Routine*)global_queue.TryPop()) != nullptr) {
+                    if (routine->AllocatedOnHeap()) {
+                        routine->Discard();
+                    }
+                }
+            }
+        }
+
+        for (size_t i = 0; i < lifo_slots_.size(); ++i) {
+            Routine* lifo = lifo_slots_[i].load(std::memory_order_relaxed);
+            if (lifo != nullptr) {
+                if (lifo->AllocatedOnHeap()) {
+                    lifo->Discard();
+                }
+            }
+
+            for (auto& local_queue : local_queues_[i]) {
+                while ((routine = local_queue.TryPop()) != nullptr) {
+                    if (routine->AllocatedOnHeap()) {
+                        routine->Discard();
+                    }
+                }
+            }
+        }
+
+        Intrusive::Queue timers;
+        for (auto& worker_timers : worker_timers_) {
+            worker_timers.wheel.TakeAll(timers);
+        }
+        timers_inbox_.Grab(timers, timers_inbox_.Size());
+
+        Detail::TimerWheel::Timer* timer;
+        while ((timer = (Detail::TimerWheel::Timer*)timers.TryPop()) != nullptr) {
+            if (timer->routine->AllocatedOnHeap()) {
+                timer->routine->Discard();
+            }
+            delete timer;
+        }
+    }
+
+    template <typename Policy>
+    void ThreadPool<Policy>::Execute(Routine *routine) {
+        Execute(routine, Priority(Priority::kNormal));
+    }
+
+    template <typename Policy>
+    void ThreadPool<Policy>::Execute(Routine *routine, Hint hint) {
+        Execute(routine, hint, Priority(Priority::kNormal));
+    }
+
+    template <typename Policy>
+    void ThreadPool<Policy>::Execute(Routine *routine, Priority priority) {
+        Hint hint(Hint::kGlobalQueue);
+        if (CurrentWorker(this) != -1) {
+            hint.hint = Hint::kLocalQueue;
+        }
+        Execute(routine, hint, priority);
+    }
+
+    template <typename Policy>
+    void ThreadPool<Policy>::Execute(Routine *routine, Hint hint, Priority priority) {
+        assert(priority.priority < Priority::kPrioritiesCount);
+        routines_wg_.Add(1);
+        bool pushed = false;
+        int worker_id = CurrentWorker(this);
+
+        // routine in the LIFO slot can't be stolen,
+        // so nobody needs to be woken up unless the old LIFO routine was moved to the local queue
+        bool need_notify = true;
+
+        // the LIFO slot has no priority, so routine of another priority goes to its local queue
+        if (hint.hint == Hint::kLIFO && priority.priority != Priority::kNormal) {
+            hint.hint = Hint::kLocalQueue;
+        }
+
+        // the local queue and the LIFO slot are only for the workers of this pool
+        if (worker_id == -1) {
+            hint.hint = Hint::kGlobalQueue;
+        }
+
+        if (hint.hint == Hint::kLocalQueue) {
+            PushRoutineInTheLocalQueue(routine, worker_id, priority.priority);
+            pushed = true;
+        }
+        else if (hint.hint == Hint::kGlobalQueue) {
+            PushRoutineInTheGlobalQueue(routine, priority.priority);
+            pushed = true;
+        }
+        else if (hint.hint == Hint::kLIFO) {
+            need_notify = PushRoutineInTheLIFOSlot(routine, worker_id);
+            pushed = true;
+        }
+
+        if (need_notify) {
+            NotifyParked();
+        }
+
+        // if user set wrong hint
+        assert(pushed);
+    }
+
+    template <typename Policy>
+    void ThreadPool<Policy>::ExecuteNext(Routine *routine) {
+        if (CurrentWorker(this) != -1) {
+            Execute(routine, Hint(Hint::kLIFO));
+        }
+        else {
+            Execute(routine);
+        }
+    }
+
+    template <typename Policy>
+    void ThreadPool<Policy>::ExecuteBatch(Intrusive::Queue&& routines) {
+        if (routines.Size() == 0) {
+            return;
+        }
+        routines_wg_.Add(routines.Size());
+
+        int worker_id = CurrentWorker(this);
+        if (worker_id != -1) {
+            PushRoutinesInTheLocalQueue(std::move(routines), worker_id, Priority::kNormal);
+        }
+        else {
+            GetGlobalQueue(Priority::kNormal).PushQueue(std::move(routines));
+        }
+
+        NotifyParked();
+    }
+
+    template <typename Policy>
+    bool ThreadPool<Policy>::ExecuteAt(Clock::time_point deadline, Routine* routine) {
+        routines_wg_.Add(1);
+        InsertTimer(new Detail::TimerWheel::Timer(ToTicks(deadline), routine));
+        return true;
+    }
+
+    template <typename Policy>
+    bool ThreadPool<Policy>::ExecuteTimerAt(Clock::time_point deadline, TimerRoutine* routine) {
+        routines_wg_.Add(1);
+        routine->SetOwner(this);
+        InsertTimer(new Detail::TimerWheel::Timer(ToTicks(deadline), routine, /*cancellable=*/true));
+        return true;
+    }
+
+    // the timer is counted by ExecuteTimerAt, and at the deadline it is dropped without Done
+    template <typename Policy>
+    void ThreadPool<Policy>::ReleaseTimer() {
+        routines_wg_.Done();
+    }
+
+    template <typename Policy>
+    void ThreadPool<Policy>::InsertTimer(Detail::TimerWheel::Timer* timer) {
+        int worker_id = CurrentWorker(this);
+        if (worker_id != -1) {
+            // worker isn't parked now, so it sees the new deadline before parking
+            uint64_t deadline = timer->deadline;
+            auto& worker_timers = worker_timers_[worker_id];
+            worker_timers.Lock();
+            bool inserted = worker_timers.wheel.Insert(timer);
+            worker_timers.Unlock();
+
+            if (!inserted) {
+                if (Routine* routine = FireTimer(timer)) {
+                    PushRoutineInTheLocalQueue(routine, worker_id, Priority::kNormal);
+                    NotifyParked();
+                }
+            }
+            else {
+                // the watcher sleeps too long for the new timer, if we are blocked before it
+                uint64_t watched_deadline = watched_deadline_.load(std::memory_order_seq_cst);
+                if (watched_deadline != 0 && deadline + kTimersTakeoverDelay + kTimersWatchInterval < watched_deadline) {
+                    WakeTimersWatcher();
+                }
+            }
+            return;
+        }
+
+        // if all workers are parked, then somebody must wake up and take the timer
+        timers_inbox_.Push(timer);
+        NotifyParked();
+    }
+
+    template <typename Policy>
+    Routine* ThreadPool<Policy>::FireTimer(Detail::TimerWheel::Timer* timer) {
+        Routine* routine = timer->routine;
+        bool cancellable = timer->cancellable;
+        delete timer;
+
+        if (cancellable && !((TimerRoutine*)routine)->TryFire()) {
+            if (routine->AllocatedOnHeap()) {
+                routine->Discard();
+            }
+            return nullptr;
+        }
+        return routine;
+    }
+
+    template <typename Policy>
+    void ThreadPool<Policy>::YieldExecute(Routine *routine) {
+        Execute(routine, Hint(Hint::kGlobalQueue));
+    }
+
+    template <typename Policy>
+    void ThreadPool<Policy>::WaitIdle() requires Policy::kWaitIdle {
+        routines_wg_.Wait();
+    }
+
+    template <typename Policy>
+    ThreadPoolStats ThreadPool<Policy>::GetStats() const {
+        ThreadPoolStats stats;
+        stats.workers.reserve(counters_.size());
+        for (auto& counters : counters_) {
+            stats.workers.push_back(counters.Snapshot());
+            stats.total += stats.workers.back();
+        }
+        return stats;
+    }
+
+    template <typename Policy>
+    void ThreadPool<Policy>::Stop() {
+        // monitor must not spawn workers anymore
+        if (monitor_.joinable()) {
+            {
+                std::lock_guard guard(monitor_mutex_);
+                monitor_stopped_ = true;
+            }
+            monitor_cv_.notify_one();
+            monitor_.join();
+        }
+
+        // stopped all threads
+        for (auto& worker : workers_) {
+            worker.closed.test_and_set(std::memory_order_release);
+        }
+
+        // wake up all parked workers
+        {
+            ::Detail::QueueSpinLock::Guard guard(sleepers_spinlock_);
+            stopped_ = true;
+            for (size_t sleeper : sleepers_) {
+                Unpark(sleeper);
+            }
+            sleepers_.clear();
+        }
+
+        for (auto& worker : workers_) {
+            if (worker.worker.joinable()) {
+                worker.worker.join();
+            }
+        }
+
+        routines_wg_.AllDone();
+    }
+
+    template <typename Policy>
+    void ThreadPool<Policy>::PushRoutineInTheGlobalQueue(Routine* routine, uint8_t priority) {
+        GetGlobalQueue(priority).Push(routine);
+    }
+
+    template <typename Policy>
+    void ThreadPool<Policy>::PushRoutineInTheLocalQueue(Routine *routine, size_t queue_id, uint8_t priority) {
+        while (!local_queues_[queue_id][priority].TryPush(routine)) {
+            GrabFromLocalQueueToGlobalQueue(queue_id, priority);
+        }
+    }
+
+    template <typename Policy>
+    void ThreadPool<Policy>::PushRoutinesInTheLocalQueue(Intrusive::Queue&& routines, size_t queue_id, uint8_t priority) {
+        auto& local_queue = local_queues_[queue_id][priority];
+
+        // only owner pushes into the local queue and thieves only free slots,
+        // so all of these pushes succeed
+        size_t free_slots = kLocalQueueSize - local_queue.Size();
+
+        Routine* routine;
+        for (size_t i = 0; i < free_slots && (routine = (Routine*)routines.TryPop()) != nullptr; ++i) {
+            bool pushed = local_queue.TryPush(routine);
+            assert(pushed);
+        }
+
+        // the rest goes to the global queue at once
+        global_queues_[worker_nodes_[queue_id]][priority].PushQueue(std::move(routines));
+    }
+
+    template <typename Policy>
+    bool ThreadPool<Policy>::PushRoutineInTheLIFOSlot(Routine *routine, size_t slot_id) {
+        Routine* lifo = lifo_slots_[slot_id].exchange(routine, std::memory_order_acq_rel);
+        if (lifo != nullptr) {
+            PushRoutineInTheLocalQueue(lifo, slot_id, Priority::kNormal);
+            return true;
+        }
+        return false;
+    }
+
+    template <typename Policy>
+    void ThreadPool<Policy>::GrabFromLocalQueueToGlobalQueue(size_t from, uint8_t priority) {
+        WorkerCounters::Add(counters_[from].overflow_spills_count);
+
+        size_t grab_size = kLocalQueueSize / 2;
+        Intrusive::Queue grab;
+        local_queues_[from][priority].Grab(grab, grab_size);
+        global_queues_[worker_nodes_[from]][priority].PushQueue(std::move(grab));
+    }
+
+    template <typename Policy>
+    void ThreadPool<Policy>::StartWorker(size_t worker_id) {
+        auto& worker = workers_[worker_id];
+        worker.retired = false;
+        worker.active.store(true, std::memory_order_relaxed);
+
+        // workers_count_ first : producers may see extra worker, but not extra unparked one
+        workers_count_.fetch_add(1, std::memory_order_seq_cst);
+        idle_state_.fetch_add(IdleState::kOneUnparked, std::memory_order_seq_cst);
+
+        worker.worker = std::thread([this](size_t j) {
+            thread_id = (int)j;
+            current_pool = this;
+
+            if (pin_workers_) {
+                PinWorker(j);
+            }
+
+            // wait until all threads are created
+            while (!can_start_.test(std::memory_order_acquire)) {
+                can_start_.wait(false, std::memory_order_relaxed);
+            }
+
+            WorkerRoutine();
+        }, worker_id);
+    }
+
+    template <typename Policy>
+    void ThreadPool<Policy>::PinWorker(size_t worker_id) const {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        if (worker_cpus_[worker_id] < CPU_SETSIZE) {
+            CPU_SET(worker_cpus_[worker_id], &cpu_set);
+            if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0) {
+                return;
+            }
+        }
+
+        // the cpu may be outside of the cpuset of the process (e.g. in the container)
+        CPU_ZERO(&cpu_set);
+        for (size_t cpu = 0; cpu < cpu_nodes_.size() && cpu < CPU_SETSIZE; ++cpu) {
+            if (cpu_nodes_[cpu] == (int)worker_nodes_[worker_id]) {
+                CPU_SET(cpu, &cpu_set);
+            }
+        }
+        // if the node isn't allowed too, the worker stays unpinned, it is only slower
+        (void)pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+    }
+
+    template <typename Policy>
+    void ThreadPool<Policy>::WorkerRoutine() {
+        size_t worker_id = thread_id;
+        auto& counters = counters_[worker_id];
+        counters.period_start = WorkerCounters::Clock::now();
+        bool searching = false;
+
+        auto& worker = workers_[worker_id];
+        // only the monitor of the elastic pool reads the ticks, so the fixed pool doesn't publish them,
+        // the executed routines are published once per kTimersCheckInterval ticks and before parking
+        const bool publish_ticks = (limits_.min_workers < limits_.max_workers);
+        uint64_t ticks = worker.ticks.load(std::memory_order_relaxed);
+        uint64_t executed_count = 0;
+        while (!worker.closed.test(std::memory_order_acquire)) {
+            ++ticks;
+            if (publish_ticks) {
+                worker.ticks.store(ticks, std::memory_order_relaxed);
+            }
+            if (ticks % kTimersCheckInterval == 0) {
+                WorkerCounters::Add(counters.executed_count, executed_count);
+                executed_count = 0;
+                ProcessTimers(worker_id);
+            }
+
+            Routine* routine = TryTake(worker_id);
+
+            // searching worker spins for a while before parking
+            for (size_t i = 0; routine == nullptr && i < kSearchingRoundsCount; ++i) {
+                if (!searching && !(searching = TransitionToSearching())) {
+                    break;
+                }
+                std::this_thread::yield();
+                routine = TryTake(worker_id);
+            }
+
+            if (routine == nullptr) {
+                WorkerCounters::Add(counters.executed_count, executed_count);
+                executed_count = 0;
+                if (ProcessTimers(worker_id) || !Park(worker_id, searching)) {
+                    continue;
+                }
+                if (worker.retired) {
+                    break;
+                }
+
+                // worker who woke us up counted us as searching
+                searching = true;
+                continue;
+            }
+
+            if (searching) {
+                searching = false;
+                if (TransitionFromSearching()) {
+                    // we were the last searching worker,
+                    // so we wake up the next one to search for the rest of the routines
+                    NotifyParked();
+                }
+            }
+
+            routine->RunAndDiscard();
+            ++executed_count;
+
+            routines_wg_.Done();
+        }
+        WorkerCounters::Add(counters.executed_count, executed_count);
+    }
+
+    template <typename Policy>
+    Routine* ThreadPool<Policy>::TryTake(size_t worker_id) {
+        auto random = workers_[worker_id].random_generator();
+        bool low_priority_first = (random % kLowPriorityUsingConstant == 0);
+
+        if (random % kGlobalQueueUsingConstant == 0) {
+            WorkerCounters::Add(counters_[worker_id].fairness_checks_count);
+            return TryTake(worker_id, TakeStrategy::GetGlobalQueueTakeStrategy(), low_priority_first);
+        }
+        if (lifo_slots_routines_count_[worker_id] >= kMaxLIFORoutinesCount) {
+            return TryTake(worker_id, TakeStrategy::GetWithoutLIFOSlotTakeStrategy(), low_priority_first);
+        }
+        return TryTake(worker_id, TakeStrategy::GetDefaultTakeStrategy(), low_priority_first);
+    }
+
+    template <typename Policy>
+    bool ThreadPool<Policy>::TransitionToSearching() {
+        uint64_t state = idle_state_.load(std::memory_order_seq_cst);
+
+        // we must maintain the invariant
+        // 2 * searching workers <= workers_.size()
+        // CAS : the check and the increment are one step, so concurrent workers can't pass the cap together
+        do {
+            if (2 * IdleState::GetSearchingCount(state) >= workers_count_.load(std::memory_order_relaxed)) {
+                return false;
+            }
+        } while (!idle_state_.compare_exchange_weak(state, state + IdleState::kOneSearching,
+                                                    std::memory_order_seq_cst, std::memory_order_seq_cst));
+        return true;
+    }
+
+    template <typename Policy>
+    bool ThreadPool<Policy>::TransitionFromSearching() {
+        uint64_t state = idle_state_.fetch_sub(IdleState::kOneSearching, std::memory_order_seq_cst);
+        return (IdleState::GetSearchingCount(state) == 1);
+    }
+
+    template <typename Policy>
+    bool ThreadPool<Policy>::NeedToWakeUp() const {
+        // pairs with the fence in Park : either we see the parked worker,
+        // or he sees our routine
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        // if somebody searches, he will find the routine
+        uint64_t state = idle_state_.load(std::memory_order_seq_cst);
+        return (IdleState::GetSearchingCount(state) == 0 &&
+                IdleState::GetUnparkedCount(state) < workers_count_.load(std::memory_order_seq_cst));
+    }
+
+    template <typename Policy>
+    void ThreadPool<Policy>::NotifyParked() {
+        if (!NeedToWakeUp()) {
+            return;
+        }
+
+        ::Detail::QueueSpinLock::Guard guard(sleepers_spinlock_);
+        if (!NeedToWakeUp() || sleepers_.empty()) {
+            return;
+        }
+
+        // woken up worker starts as searching
+        idle_state_.fetch_add(IdleState::kOneUnparked + IdleState::kOneSearching, std::memory_order_seq_cst);
+
+        size_t sleeper = sleepers_.back();
+        sleepers_.pop_back();
+        Unpark(sleeper);
+    }
+
+    template <typename Policy>
+    bool ThreadPool<Policy>::Park(size_t worker_id, bool searching) {
+        bool last_searching;
+        auto& worker_timers = worker_timers_[worker_id];
+
+        {
+            ::Detail::QueueSpinLock::Guard guard(sleepers_spinlock_);
+            if (stopped_) {
+                return false;
+            }
+
+            uint64_t dec = IdleState::kOneUnparked + (searching ? IdleState::kOneSearching : 0);
+            uint64_t state = idle_state_.fetch_sub(dec, std::memory_order_seq_cst);
+            last_searching = searching && IdleState::GetSearchingCount(state) == 1;
+
+            sleepers_.push_back(worker_id);
+            workers_[worker_id].parked_since = std::chrono::steady_clock::now();
+            workers_[worker_id].has_timers = (worker_timers.next_deadline.load(std::memory_order_relaxed) !=
+                                              WorkerTimers::kNoDeadline);
+        }
+
+        // routine could have been pushed when we were searching,
+        // and producer saw us and didn't wake anybody up
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (last_searching && HasRoutinesToSteal()) {
+            NotifyParked();
+        }
+
+        auto& parker = workers_[worker_id].parker;
+        if (!parker.IsNotified()) {
+            auto& counters = counters_[worker_id];
+            WorkerCounters::Add(counters.parks_count);
+            counters.FinishPeriod(counters.busy_ns);
+
+            // worker with timers sleeps until the nearest deadline
+            uint64_t next_deadline = worker_timers.next_deadline.load(std::memory_order_relaxed);
+
+            // one parked worker also wakes up for the timers of the others, if their owners don't come to them,
+            // it is in sleepers_ already, so the inserter of the earlier timer can wake it up
+            int no_watcher = -1;
+            bool watcher = timers_watcher_.compare_exchange_strong(no_watcher, (int)worker_id,
+                                                                   std::memory_order_seq_cst);
+            if (watcher) {
+                // seq_cst : either the inserter sees the watcher, or the watcher sees the new deadline
+                watched_deadline_.store(WorkerTimers::kNoDeadline, std::memory_order_seq_cst);
+                uint64_t others_deadline = WorkerTimers::kNoDeadline;
+                for (size_t i = 0; i < worker_timers_.size(); ++i) {
+                    if (i != worker_id) {
+                        others_deadline = std::min(others_deadline,
+                                                   worker_timers_[i].next_deadline.load(std::memory_order_seq_cst));
+                    }
+                }
+                if (others_deadline != WorkerTimers::kNoDeadline) {
+                    others_deadline = std::max(others_deadline + kTimersTakeoverDelay,
+                                               NowTicks() + kTimersWatchInterval);
+                }
+                watched_deadline_.store(others_deadline, std::memory_order_seq_cst);
+                next_deadline = std::min(next_deadline, others_deadline);
+            }
+
+            if (next_deadline == WorkerTimers::kNoDeadline) {
+                parker.Wait();
+            }
+            else if (!parker.WaitUntil(timers_epoch_ + std::chrono::milliseconds(next_deadline))) {
+                ::Detail::QueueSpinLock::Guard guard(sleepers_spinlock_);
+                auto sleeper = std::find(sleepers_.begin(), sleepers_.end(), worker_id);
+                if (sleeper != sleepers_.end()) {
+                    // nobody woke us up, so we leave sleepers_ ourselves like NotifyParked does it
+                    sleepers_.erase(sleeper);
+                    idle_state_.fetch_add(IdleState::kOneUnparked + IdleState::kOneSearching,
+                                          std::memory_order_seq_cst);
+                }
+                else {
+                    // somebody is waking us up right now
+                    guard.Unlock();
+                    parker.Wait();
+                }
+            }
+
+            if (watcher) {
+                watched_deadline_.store(0, std::memory_order_seq_cst);
+                timers_watcher_.store(-1, std::memory_order_seq_cst);
+            }
+
+            WorkerCounters::Add(counters.unparks_count);
+            counters.FinishPeriod(counters.idle_ns);
+        }
+        parker.Reset();
+        return true;
+    }
+
+    template <typename Policy>
+    void ThreadPool<Policy>::Unpark(size_t worker_id) {
+        workers_[worker_id].parker.Notify();
+    }
+
+    template <typename Policy>
+    bool ThreadPool<Policy>::HasRoutinesToSteal() const {
+        if (timers_inbox_.Size() != 0) {
+            return true;
+        }
+
+        for (auto& node_queues : global_queues_) {
+            for (auto& global_queue : node_queues) {
+                if (global_queue.Size() != 0) {
+                    return true;
+                }
+            }
+        }
+
+        for (auto& worker_queues : local_queues_) {
+            for (auto& local_queue : worker_queues) {
+                if (local_queue.Size() != 0) {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    template <typename Policy>
+    Routine *ThreadPool<Policy>::TryTake(size_t worker_id, TakeStrategy strategy, bool low_priority_first) {
+        // strict order : all steps for the higher priority before any step for the lower one
+        for (size_t i = 0; i < Priority::kPrioritiesCount; ++i) {
+            uint8_t priority = (low_priority_first ? Priority::kPrioritiesCount - 1 - i : i);
+
+            Routine* result = nullptr;
+            bool was_local_queue = false;
+            for (auto step : strategy.steps) {
+                if (step == TakeStrategy::kLIFOSlot) {
+                    if (priority != Priority::kNormal) {
+                        continue;
+                    }
+                    result = TryTakeRoutineFromLIFOSlot(worker_id);
+                }
+                else if (step == TakeStrategy::kLocalQueue) {
+                    was_local_queue = true;
+                    result = TryTakeRoutineFromLocalQueue(worker_id, priority);
+                }
+                else if (step == TakeStrategy::kGlobalQueue) {
+                    // because if we served local queue then it is empty
+                    result = TryTakeRoutineFromGlobalQueue(worker_id, priority, /*grab=*/was_local_queue);
+                }
+                else if (step == TakeStrategy::kGrab) {
+                    result = TryGrabRoutineFromLocalQueue(worker_id, priority);
+                }
+
+                if (result == nullptr) {
+                    continue;
+                }
+
+                // the LIFO slot as the last step means the queues were checked and empty,
+                // so they had their turn and the next routines may use the slot again
+                if (step == TakeStrategy::kLIFOSlot && step != strategy.steps[3]) {
+                    ++lifo_slots_routines_count_[worker_id];
+                }
+                else {
+                    lifo_slots_routines_count_[worker_id] = 0;
+                }
+
+                auto& counters = counters_[worker_id];
+                if (step == TakeStrategy::kLIFOSlot) {
+                    WorkerCounters::Add(counters.lifo_slot_count);
+                }
+                else if (step == TakeStrategy::kLocalQueue) {
+                    WorkerCounters::Add(counters.local_queue_count);
+                }
+                else if (step == TakeStrategy::kGlobalQueue) {
+                    WorkerCounters::Add(counters.global_queue_count);
+                }
+                return result;
+            }
+        }
+
+        return nullptr;
+    }
+
+    template <typename Policy>
+    Routine *ThreadPool<Policy>::TryTakeRoutineFromLIFOSlot(size_t worker_id) {
+        auto& lifo_slot = lifo_slots_[worker_id];
+        // owner sees its own pushes, so the empty slot is checked without the exchange
+        if (lifo_slot.load(std::memory_order_relaxed) == nullptr) {
+            return nullptr;
+        }
+        return lifo_slot.exchange(nullptr, std::memory_order_acq_rel);
+    }
+
+    template <typename Policy>
+    Routine *ThreadPool<Policy>::TryTakeRoutineFromLocalQueue(size_t worker_id, uint8_t priority) {
+        auto& local_queue = local_queues_[worker_id][priority];
+
+        // owner sees the exact bottom, so it's cheap check without the fence in TryPop
+        if (local_queue.Size() == 0) {
+            return nullptr;
+        }
+        return local_queue.TryPop();
+    }
+
+    template <typename Policy>
+    LockFree::IntrusiveQueue& ThreadPool<Policy>::GetGlobalQueue(uint8_t priority) {
+        int worker_id = CurrentWorker(this);
+        if (worker_id != -1) {
+            return global_queues_[worker_nodes_[worker_id]][priority];
+        }
+
+        if (global_queues_.size() == 1) {
+            return global_queues_[0][priority];
+        }
+
+        // external thread pushes into the queue of its own node
+        int cpu = sched_getcpu();
+        if (cpu >= 0 && (size_t)cpu < cpu_nodes_.size() && cpu_nodes_[cpu] != -1) {
+            return global_queues_[cpu_nodes_[cpu]][priority];
+        }
+        return global_queues_[(size_t)std::max(cpu, 0) % global_queues_.size()][priority];
+    }
+
+    template <typename Policy>
+    Routine *ThreadPool<Policy>::TryTakeRoutineFromGlobalQueue(size_t worker_id, uint8_t priority, bool grab) {
+        // own node queue first, then remote ones
+        size_t node = worker_nodes_[worker_id];
+        Intrusive::Queue grabbed;
+        for (size_t i = 0; i < global_queues_.size() && grabbed.Size() == 0; ++i) {
+            size_t queue_node = (node + i) % global_queues_.size();
+            auto& global_queue = global_queues_[queue_node][priority];
+            if (global_queue.Size() == 0) {
+                continue;
+            }
+
+            size_t grabbed_count = 1;
+            if (grab) {
+                grabbed_count += std::min(kLocalQueueSize / 2,
+                                          global_queue.Size() / node_workers_[queue_node].size());
+            }
+
+            // one pass through the global queue for the result and the routines for the local queue
+            global_queue.Grab(grabbed, grabbed_count);
+        }
+        auto* result = (Routine*)grabbed.TryPop();
+
+        Routine* routine;
+        while ((routine = (Routine*)grabbed.TryPop()) != nullptr) {
+            PushRoutineInTheLocalQueue(routine, worker_id, priority);
+        }
+
+        return result;
+    }
+
+    template <typename Policy>
+    Routine *ThreadPool<Policy>::TryGrabRoutineFromLocalQueue(size_t to, uint8_t priority) {
+        auto& random_generator = workers_[to].random_generator;
+        size_t node = worker_nodes_[to];
+
+        // same node victim first, his routines are closer to us
+        LocalQueue* victim = ChooseVictim(node, to, priority);
+
+        LocalQueue* remote_victim = nullptr;
+        if (node_workers_.size() > 1) {
+            size_t remote_node;
+            while ((remote_node = random_generator() % node_workers_.size()) == node) {
+            }
+            remote_victim = ChooseVictim(remote_node, to, priority);
+        }
+
+        // most of the lanes are empty, so we don't disturb robbers_count_ for nothing
+        if ((victim == nullptr || victim->Size() == 0) && (remote_victim == nullptr || remote_victim->Size() == 0)) {
+            return nullptr;
+        }
+
+        size_t workers_count = workers_count_.load(std::memory_order_relaxed);
+        auto old_robbers_count = robbers_count_.load(std::memory_order_relaxed);
+        while (old_robbers_count < workers_count && !robbers_count_.compare_exchange_weak(old_robbers_count,
+                                                                                          old_robbers_count + 1,
+                                                                                          std::memory_order_acq_rel,
+                                                                                          std::memory_order_relaxed)) {
+        }
+
+        // To many robbers
+        if (old_robbers_count >= workers_count) {
+            return nullptr;
+        }
+
+        Intrusive::Queue grabbed;
+        if (victim != nullptr) {
+            victim->Grab(grabbed, kLocalQueueSize / 4);
+        }
+        bool remote = false;
+        if (grabbed.Size() == 0 && remote_victim != nullptr) {
+            remote_victim->Grab(grabbed, kLocalQueueSize / 4);
+            remote = true;
+        }
+        robbers_count_.fetch_sub(1, std::memory_order_release);
+
+        auto& counters = counters_[to];
+        WorkerCounters::Add(counters.steal_attempts_count);
+        if (grabbed.Size() != 0) {
+            WorkerCounters::Add(counters.steal_successes_count);
+            if (remote) {
+                WorkerCounters::Add(counters.remote_steals_count);
+            }
+        }
+
+        auto* result = (Routine*)grabbed.TryPop();
+        Routine* routine;
+        while ((routine = (Routine*)grabbed.TryPop()) != nullptr) {
+            PushRoutineInTheLocalQueue(routine, to, priority);
+        }
+
+        return result;
+    }
+
+    template <typename Policy>
+    typename ThreadPool<Policy>::LocalQueue* ThreadPool<Policy>::ChooseVictim(size_t node, size_t to, uint8_t priority) {
+        auto& node_workers = node_workers_[node];
+        size_t start = workers_[to].random_generator() % node_workers.size();
+
+        // workers come and go in the elastic mode, so we take the first active one after the random start
+        for (size_t i = 0; i < node_workers.size(); ++i) {
+            size_t from = node_workers[(start + i) % node_workers.size()];
+            if (from != to && workers_[from].active.load(std::memory_order_relaxed)) {
+                return &local_queues_[from][priority];
+            }
+        }
+        return nullptr;
+    }
+
+    template <typename Policy>
+    void ThreadPool<Policy>::MonitorRoutine() {
+        std::vector<uint64_t> last_ticks(workers_.size(), 0);
+
+        std::unique_lock lock(monitor_mutex_);
+        while (!monitor_cv_.wait_for(lock, limits_.blocking_threshold, [this] { return monitor_stopped_; })) {
+            RetireIdleWorkers();
+            CompensateBlockedWorkers(last_ticks);
+        }
+    }
+
+    template <typename Policy>
+    void ThreadPool<Policy>::RetireIdleWorkers() {
+        std::vector<size_t> retired;
+
+        {
+            ::Detail::QueueSpinLock::Guard guard(sleepers_spinlock_);
+            auto now = std::chrono::steady_clock::now();
+
+            size_t kept_count = 0;
+            for (size_t sleeper : sleepers_) {
+                auto& worker = workers_[sleeper];
+                if (workers_count_.load(std::memory_order_relaxed) <= limits_.min_workers ||
+                    worker.has_timers || now - worker.parked_since < limits_.keep_alive) {
+                    sleepers_[kept_count++] = sleeper;
+                    continue;
+                }
+
+                // parked worker has empty queues and is already not counted as unparked
+                worker.active.store(false, std::memory_order_relaxed);
+                worker.retired = true;
+                workers_count_.fetch_sub(1, std::memory_order_seq_cst);
+                Unpark(sleeper);
+
+                retired.push_back(sleeper);
+            }
+            sleepers_.resize(kept_count);
+        }
+
+        for (size_t worker_id : retired) {
+            workers_[worker_id].worker.join();
+        }
+    }
+
+    template <typename Policy>
+    void ThreadPool<Policy>::CompensateBlockedWorkers(std::vector<uint64_t>& last_ticks) {
+        // worker is blocked if it hasn't tried to take a routine since the previous check
+        size_t blocked_count = 0;
+        size_t free_slot = workers_.size();
+        for (size_t i = 0; i < workers_.size(); ++i) {
+            if (!workers_[i].active.load(std::memory_order_relaxed)) {
+                free_slot = std::min(free_slot, i);
+                continue;
+            }
+
+            uint64_t ticks = workers_[i].ticks.load(std::memory_order_relaxed);
+            if (ticks == last_ticks[i]) {
+                ++blocked_count;
+                // the LIFO slot can't be stolen, so its routine would wait for the blocked owner
+                if (Routine* lifo = lifo_slots_[i].exchange(nullptr, std::memory_order_acq_rel)) {
+                    global_queues_[worker_nodes_[i]][Priority::kNormal].Push(lifo);
+                    NotifyParked();
+                }
+            }
+            last_ticks[i] = ticks;
+        }
+
+        if (free_slot == workers_.size() || blocked_count < workers_count_.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        // parked workers don't tick too, but producers wake them up themselves
+        {
+            ::Detail::QueueSpinLock::Guard guard(sleepers_spinlock_);
+            if (!sleepers_.empty()) {
+                return;
+            }
+        }
+
+        if (HasRoutinesToSteal()) {
+            StartWorker(free_slot);
+        }
+    }
+
+    template <typename Policy>
+    uint64_t ThreadPool<Policy>::ToTicks(Clock::time_point deadline) const {
+        if (deadline <= timers_epoch_) {
+            return 0;
+        }
+        return (uint64_t)std::chrono::ceil<std::chrono::milliseconds>(deadline - timers_epoch_).count();
+    }
+
+    template <typename Policy>
+    uint64_t ThreadPool<Policy>::NowTicks() const {
+        return (uint64_t)std::chrono::floor<std::chrono::milliseconds>(Clock::now() - timers_epoch_).count();
+    }
+
+    template <typename Policy>
+    bool ThreadPool<Policy>::ProcessTimers(size_t worker_id) {
+        auto& worker_timers = worker_timers_[worker_id];
+        Intrusive::Queue expired;
+
+        // no clock reading if there are no timers, and no lock if none of them is expired
+        bool has_inbox = (timers_inbox_.Size() != 0);
+        uint64_t next_deadline = worker_timers.next_deadline.load(std::memory_order_relaxed);
+        if (has_inbox || (next_deadline != WorkerTimers::kNoDeadline && next_deadline <= NowTicks())) {
+            worker_timers.Lock();
+            if (has_inbox) {
+                Intrusive::Queue inbox;
+                timers_inbox_.Grab(inbox, timers_inbox_.Size());
+
+                Detail::TimerWheel::Timer* timer;
+                while ((timer = (Detail::TimerWheel::Timer*)inbox.TryPop()) != nullptr) {
+                    if (!worker_timers.wheel.Insert(timer)) {
+                        expired.Push(timer);
+                    }
+                }
+            }
+            worker_timers.wheel.Advance(NowTicks(), expired);
+            worker_timers.Unlock();
+        }
+
+        TakeOverdueTimers(worker_id, expired);
+
+        if (expired.Size() == 0) {
+            return false;
+        }
+
+        Detail::TimerWheel::Timer* timer;
+        while ((timer = (Detail::TimerWheel::Timer*)expired.TryPop()) != nullptr) {
+            if (Routine* routine = FireTimer(timer)) {
+                PushRoutineInTheLocalQueue(routine, worker_id, Priority::kNormal);
+            }
+        }
+        NotifyParked();
+
+        return true;
+    }
+
+    template <typename Policy>
+    void ThreadPool<Policy>::TakeOverdueTimers(size_t worker_id, Intrusive::Queue& expired) {
+        uint64_t now = 0;
+        for (size_t i = 0; i < worker_timers_.size(); ++i) {
+            auto& worker_timers = worker_timers_[i];
+            uint64_t next_deadline = worker_timers.next_deadline.load(std::memory_order_relaxed);
+            if (i == worker_id || next_deadline == WorkerTimers::kNoDeadline) {
+                continue;
+            }
+
+            if (now == 0) {
+                now = NowTicks();
+            }
+            // the owner is at its wheel right now
+            if (next_deadline + kTimersTakeoverDelay > now || !worker_timers.TryLock()) {
+                continue;
+            }
+            // fresh timers are left to the owner
+            worker_timers.wheel.Advance(now - kTimersTakeoverDelay, expired);
+            worker_timers.Unlock();
+        }
+    }
+
+    template <typename Policy>
+    void ThreadPool<Policy>::WakeTimersWatcher() {
+        int watcher = timers_watcher_.load(std::memory_order_seq_cst);
+        if (watcher == -1) {
+            return;
+        }
+
+        // like NotifyParked, but for the certain worker
+        ::Detail::QueueSpinLock::Guard guard(sleepers_spinlock_);
+        auto sleeper = std::find(sleepers_.begin(), sleepers_.end(), (size_t)watcher);
+        if (sleeper == sleepers_.end()) {
+            return;
+        }
+        sleepers_.erase(sleeper);
+        idle_state_.fetch_add(IdleState::kOneUnparked + IdleState::kOneSearching, std::memory_order_seq_cst);
+        Unpark((size_t)watcher);
+    }
+
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+namespace Executors {
+
+    struct WorkerStats {
+        // routines completed by the worker
+        uint64_t executed_count = 0;
+
+        // where routines were taken from
+        uint64_t lifo_slot_count = 0;
+        uint64_t local_queue_count = 0;
+        uint64_t global_queue_count = 0;
+
+        // how many times worker looked into the global queue first for fairness
+        uint64_t fairness_checks_count = 0;
+
+        uint64_t steal_attempts_count = 0;
+        uint64_t steal_successes_count = 0;
+        // successful steals from the worker of another NUMA node
+        uint64_t remote_steals_count = 0;
+
+        // how many times the local queue was full and half of it was moved to the global queue
+        uint64_t overflow_spills_count = 0;
+
+        uint64_t parks_count = 0;
+        uint64_t unparks_count = 0;
+
+        // busy : worker runs or searches for routines, idle : worker is parked
+        uint64_t busy_ns = 0;
+        uint64_t idle_ns = 0;
+
+        WorkerStats& operator+=(const WorkerStats& other) {
+            executed_count += other.executed_count;
+            lifo_slot_count += other.lifo_slot_count;
+            local_queue_count += other.local_queue_count;
+            global_queue_count += other.global_queue_count;
+            fairness_checks_count += other.fairness_checks_count;
+            steal_attempts_count += other.steal_attempts_count;
+            steal_successes_count += other.steal_successes_count;
+            remote_steals_count += other.remote_steals_count;
+            overflow_spills_count += other.overflow_spills_count;
+            parks_count += other.parks_count;
+            unparks_count += other.unparks_count;
+            busy_ns += other.busy_ns;
+            idle_ns += other.idle_ns;
+            return *this;
+        }
+    };
+
+    struct ThreadPoolStats {
+        std::vector<WorkerStats> workers;
+        WorkerStats total;
+    };
+
+    // written only by the owning worker, so increments are plain relaxed load + store
+    // and may be read by anyone at any time
+    struct alignas(64) WorkerCounters {
+        using Clock = std::chrono::steady_clock;
+
+        std::atomic<uint64_t> executed_count{ 0 };
+        std::atomic<uint64_t> lifo_slot_count{ 0 };
+        std::atomic<uint64_t> local_queue_count{ 0 };
+        std::atomic<uint64_t> global_queue_count{ 0 };
+        std::atomic<uint64_t> fairness_checks_count{ 0 };
+        std::atomic<uint64_t> steal_attempts_count{ 0 };
+        std::atomic<uint64_t> steal_successes_count{ 0 };
+        std::atomic<uint64_t> remote_steals_count{ 0 };
+        std::atomic<uint64_t> overflow_spills_count{ 0 };
+        std::atomic<uint64_t> parks_count{ 0 };
+        std::atomic<uint64_t> unparks_count{ 0 };
+        std::atomic<uint64_t> busy_ns{ 0 };
+        std::atomic<uint64_t> idle_ns{ 0 };
+
+        // start of the current busy or idle period, only for owner
+        Clock::time_point period_start = Clock::now();
+
+        static void Add(std::atomic<uint64_t>& counter, uint64_t value = 1) {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        // finishes current period and adds its duration to counter
+        void FinishPeriod(std::atomic<uint64_t>& counter) {
+            auto now = Clock::now();
+            Add(counter, std::chrono::duration_cast<std::chrono::nanoseconds>(now - period_start).count());
+            period_start = now;
+        }
+
+        [[nodiscard]] WorkerStats Snapshot() const {
+            WorkerStats stats;
+            stats.executed_count = executed_count.load(std::memory_order_relaxed);
+            stats.lifo_slot_count = lifo_slot_count.load(std::memory_order_relaxed);
+            stats.local_queue_count = local_queue_count.load(std::memory_order_relaxed);
+            stats.global_queue_count = global_queue_count.load(std::memory_order_relaxed);
+            stats.fairness_checks_count = fairness_checks_count.load(std::memory_order_relaxed);
+            stats.steal_attempts_count = steal_attempts_count.load(std::memory_order_relaxed);
+            stats.steal_successes_count = steal_successes_count.load(std::memory_order_relaxed);
+            stats.remote_steals_count = remote_steals_count.load(std::memory_order_relaxed);
+            stats.overflow_spills_count = overflow_spills_count.load(std::memory_order_relaxed);
+            stats.parks_count = parks_count.load(std::memory_order_relaxed);
+            stats.unparks_count = unparks_count.load(std::memory_order_relaxed);
+            stats.busy_ns = busy_ns.load(std::memory_order_relaxed);
+            stats.idle_ns = idle_ns.load(std::memory_order_relaxed);
+            return stats;
+        }
+    };
+
+}
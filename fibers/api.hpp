@@ -6,12 +6,24 @@
 #include "../futures/api/future.hpp"
 #include "fiber.hpp"
 #include "../futures/detail/type_traits.hpp"
+#include "../cancellation/stop_token.hpp"
 
 namespace Fibers {
 
-    void Go(Executors::IExecutor& sched, std::function<void()> routine) {
-        auto* fiber = new Fiber(std::move(routine), sched);
-        fiber->Schedule();
+    // body is moved right into the fiber stack
+    template <typename Body>
+    void Go(Executors::IExecutor& sched, Body&& routine) {
+        Fiber::Create(std::forward<Body>(routine), sched)->Schedule();
+    }
+
+    // body is skipped, if stop is requested before the fiber starts
+    template <typename Body>
+    void Go(Executors::IExecutor& sched, Body&& routine, Cancellation::StopToken token) {
+        Go(sched, [routine = std::forward<Body>(routine), token = std::move(token)]() mutable {
+            if (!token.StopRequested()) {
+                routine();
+            }
+        });
     }
 
     template <typename Functor>
@@ -52,6 +64,16 @@ namespace Fibers {
             Suspend(&awaiter);
         }
 
+        // fiber is resumed by the timer of its executor, no thread is blocked
+        void SleepUntil(Executors::Clock::time_point deadline) {
+            Awaiters::SleepAwaiter awaiter(Fiber::Self(), deadline);
+            Suspend(&awaiter);
+        }
+
+        void SleepFor(Executors::Clock::duration delay) {
+            SleepUntil(Executors::Clock::now() + delay);
+        }
+
         // non-blocking future wait
         template <typename T>
         auto Await(Futures::Future<T>&& future) {
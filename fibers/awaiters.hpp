@@ -8,6 +8,7 @@
 #include "../intrusive/structures/singly_directed_list_node.hpp"
 #include "../intrusive/structures/bidirectional_list_node.hpp"
 #include "../intrusive/structures/list.hpp"
+#include "../cancellation/stop_token.hpp"
 #include <optional>
 
 namespace Fibers::Awaiters {
@@ -43,22 +44,220 @@ namespace Fibers::Awaiters {
         FiberHandle handle_;
     };
 
-    class MutexAwaiter : public IAwaiter, public Intrusive::SinglyDirectedListNode {
+    class SleepAwaiter : public IAwaiter {
     public:
-        MutexAwaiter(FiberHandle handle, Detail::QueueSpinLock::Guard& guard) : handle_(handle), guard_(guard) {
+        SleepAwaiter(FiberHandle handle, Executors::Clock::time_point deadline) :
+                     handle_(handle), deadline_(deadline) {
         }
 
         void AwaitSuspend() override {
+            handle_.ScheduleAt(deadline_);
+        }
+
+    private:
+        FiberHandle handle_;
+        Executors::Clock::time_point deadline_;
+    };
+
+    class ITimedAwaiter {
+    public:
+        virtual ~ITimedAwaiter() = default;
+
+        // called at most once, if the deadline fires before the wakeup
+        virtual void OnTimeout() = 0;
+    };
+
+    // timer of the timed wait, it races with the waker for the state of the timer routine
+    // the loser doesn't touch the awaiter, so the awaiter may die right after its fiber is resumed
+    //
+    // owned by the timer, frees itself when the timer fires or is dropped by the executor after cancel
+    class TimeoutTask final : public Executors::TimerRoutine {
+    public:
+        explicit TimeoutTask(ITimedAwaiter* awaiter) : awaiter_(awaiter) {
+        }
+
+        static void* operator new(size_t size) {
+            return ::Detail::SlabAllocator::Allocate(size);
+        }
+
+        static void operator delete(void* ptr, size_t size) {
+            ::Detail::SlabAllocator::Deallocate(ptr, size);
+        }
+
+        bool AllocatedOnHeap() override {
+            return true;
+        }
+
+        void Run() override {
+            ran_ = true;
+            if (TryFire()) {
+                awaiter_->OnTimeout();
+            }
+        }
+
+        void Discard() override {
+            // discarded without Run (executor is stopped) before the wakeup :
+            // the waker can still come to TryCancel, so the task is leaked like the suspended fiber
+            if (ran_ || !TryFire()) {
+                delete this;
+            }
+        }
+
+    private:
+        ITimedAwaiter* awaiter_;
+        bool ran_ = false;
+    };
+
+    // deadline and stop token of the awaiter, that waits in the list guarded by spinlock
+    // on timeout or stop the awaiter leaves the list by itself and its fiber is resumed
+    //
+    // timer, stop callback and the waker race for the single flag under spinlock,
+    // the flag is in the timer, if there is one, because the timer can fire after the awaiter is gone
+    class ListTimeout : public ITimedAwaiter, public Cancellation::StopCallback {
+    public:
+        ListTimeout(FiberHandle handle, Executors::Clock::time_point deadline,
+                    Intrusive::List& list, ::Detail::QueueSpinLock& spinlock,
+                    Cancellation::StopToken token = {}) :
+                    handle_(handle), deadline_(deadline), list_(list), spinlock_(spinlock), token_(std::move(token)) {
+        }
+
+        // the stop callback may be running on the other thread
+        ~ListTimeout() noexcept override {
+            if (stop_registered_) {
+                token_.Unregister(this);
+            }
+        }
+
+        // under spinlock, after node is pushed into the list
+        // return false if stop was already requested, then the awaiter has left the list and must be resumed
+        // by its fiber after spinlock is released
+        bool Arm(Intrusive::BidirectionalListNode* node) {
+            node_ = node;
+            linked_ = true;
+
+            if (token_.StopPossible()) {
+                stop_registered_ = token_.Register(this);
+                if (!stop_registered_) {
+                    fired_ = true;
+                    list_.Unlink(node_);
+                    linked_ = false;
+                    cancelled_ = true;
+                    return false;
+                }
+            }
+
+            if (deadline_ != Executors::Clock::time_point::max()) {
+                timer_ = new TimeoutTask(this);
+                handle_.ExecuteTimerAt(deadline_, timer_);
+            }
+            return true;
+        }
+
+        // for the waker, under spinlock, after node is popped from the list
+        // return false if the deadline has already fired or stop was requested, then the awaiter must be skipped
+        bool TryCancel() {
+            linked_ = false;
+            return TryWin();
+        }
+
+        void OnTimeout() override {
+            {
+                // the timer is freed after it, the stop callback must not touch it
+                ::Detail::QueueSpinLock::Guard guard(spinlock_);
+                timer_ = nullptr;
+                fired_ = true;
+                Leave();
+            }
+
+            expired_ = true;
+            handle_.Schedule();
+        }
+
+        void OnStop() override {
+            {
+                ::Detail::QueueSpinLock::Guard guard(spinlock_);
+                if (!TryWin()) {
+                    return;
+                }
+                Leave();
+            }
+
+            cancelled_ = true;
+            handle_.Schedule();
+        }
+
+        [[nodiscard]] bool Expired() const {
+            return expired_;
+        }
+
+        [[nodiscard]] bool Cancelled() const {
+            return cancelled_;
+        }
+
+    private:
+        // under spinlock, the timer frees itself after the race, so it isn't touched again
+        bool TryWin() {
+            bool won = (timer_ != nullptr ? timer_->TryCancel() : !fired_);
+            timer_ = nullptr;
+            fired_ = true;
+            return won;
+        }
+
+        // under spinlock
+        void Leave() {
+            if (linked_) {
+                list_.Unlink(node_);
+                linked_ = false;
+            }
+        }
+
+    private:
+        FiberHandle handle_;
+        Executors::Clock::time_point deadline_;
+        Intrusive::BidirectionalListNode* node_ = nullptr;
+        Intrusive::List& list_;
+        ::Detail::QueueSpinLock& spinlock_;
+        TimeoutTask* timer_ = nullptr;
+
+        Cancellation::StopToken token_;
+        bool stop_registered_ = false;
+
+        // guarded by spinlock
+        bool linked_ = false;
+        bool fired_ = false;
+
+        bool expired_ = false;
+        bool cancelled_ = false;
+    };
+
+    class MutexAwaiter : public IAwaiter, public Intrusive::BidirectionalListNode {
+    public:
+        MutexAwaiter(FiberHandle handle, Detail::QueueSpinLock::Guard& guard,
+                     ListTimeout* timeout = nullptr) : handle_(handle), guard_(guard), timeout_(timeout) {
+        }
+
+        // nobody else resumes the fiber, if the awaiter isn't armed
+        void AwaitSuspend() override {
+            bool armed = (timeout_ == nullptr || timeout_->Arm(this));
             guard_.Unlock();
+            if (!armed) {
+                handle_.Schedule();
+            }
         }
 
-        void Resume() {
+        // return false if the awaiter has already timed out
+        bool TryResume() {
+            if (timeout_ != nullptr && !timeout_->TryCancel()) {
+                return false;
+            }
             handle_.Schedule();
+            return true;
         }
 
     private:
         FiberHandle handle_;
         Detail::QueueSpinLock::Guard& guard_;
+        ListTimeout* timeout_;
     };
 
     class WaitGroupAwaiter : public IAwaiter, public Intrusive::SinglyDirectedListNode {
@@ -106,34 +305,58 @@ namespace Fibers::Awaiters {
     };
 
     template <typename T>
-    class ChannelProducerAwaiter : public IAwaiter, public Intrusive::SinglyDirectedListNode {
+    class ChannelProducerAwaiter : public IAwaiter, public Intrusive::BidirectionalListNode {
     public:
         ChannelProducerAwaiter(FiberHandle handle, T&& result,
-                               ::Detail::QueueSpinLock::Guard& guard) :
-                               handle_(handle), result_(std::forward<T>(result)), guard_(guard) {
+                               ::Detail::QueueSpinLock::Guard& guard, ListTimeout* timeout = nullptr) :
+                               handle_(handle), result_(std::forward<T>(result)), guard_(guard), timeout_(timeout) {
         }
 
         void AwaitSuspend() override {
+            bool armed = (timeout_ == nullptr || timeout_->Arm(this));
             guard_.Unlock();
+            if (!armed) {
+                handle_.Schedule();
+            }
         }
 
+        // for the consumer, return false if the awaiter has already left
+        bool TryAcquire() {
+            return (timeout_ == nullptr || timeout_->TryCancel());
+        }
+
+        // the value is taken before the fiber is scheduled : then the awaiter can be destroyed
         T Resume() {
+            T result = std::move(result_);
             handle_.Schedule();
-            return std::move(result_);
+            return result;
+        }
+
+        // the value is left in the awaiter, when it has left without the consumer
+        T& GetValue() {
+            return result_;
         }
 
     private:
         ::Detail::QueueSpinLock::Guard& guard_;
         FiberHandle handle_;
         T result_;
+        ListTimeout* timeout_;
     };
 
     class ChannelConsumerAwaiterBase : public IAwaiter, public Intrusive::BidirectionalListNode {
     public:
+        // for select, under spinlock of the channel : queue of the awaiter, nullptr if it isn't linked
         virtual void SetQueue(Intrusive::List* queue) {
         }
 
-        virtual void SetIndex(int index) {
+        virtual Intrusive::List* GetQueue() {
+            return nullptr;
+        }
+
+        // for the producer, return false if the awaiter has already timed out
+        virtual bool TryAcquire() {
+            return true;
         }
     };
 
@@ -147,11 +370,20 @@ namespace Fibers::Awaiters {
     class ChannelConsumerAwaiter : public IChannelConsumerAwaiter<T> {
     public:
         ChannelConsumerAwaiter(FiberHandle fiber, std::optional<T>& result,
-                               ::Detail::QueueSpinLock::Guard& guard) : fiber_(fiber), result_(result), guard_(guard) {
+                               ::Detail::QueueSpinLock::Guard& guard, ListTimeout* timeout = nullptr) :
+                               fiber_(fiber), result_(result), guard_(guard), timeout_(timeout) {
         }
 
         void AwaitSuspend() override {
+            bool armed = (timeout_ == nullptr || timeout_->Arm(this));
             guard_.Unlock();
+            if (!armed) {
+                fiber_.Schedule();
+            }
+        }
+
+        bool TryAcquire() override {
+            return (timeout_ == nullptr || timeout_->TryCancel());
         }
 
         void Resume(T&& result) override {
@@ -163,51 +395,78 @@ namespace Fibers::Awaiters {
         FiberHandle fiber_;
         std::optional<T>& result_;
         ::Detail::QueueSpinLock::Guard& guard_;
+        ListTimeout* timeout_;
     };
 
-    template <typename T, typename Variant, size_t Size>
-    class SelectorAwaiter : public IChannelConsumerAwaiter<T> {
+    // shared by the awaiters of one select
+    // the first producer or the stop callback acquires the select, the others skip its awaiters
+    struct SelectState {
+        explicit SelectState(FiberHandle fiber) : fiber(fiber) {
+        }
+
+        FiberHandle fiber;
+        std::atomic<bool> acquired{ false };
+
+        // the second of the winner and the suspended fiber schedules the fiber
+        std::atomic_flag is_result_set{ false };
+
+        void ResumeOnce() {
+            if (is_result_set.test_and_set(std::memory_order_acq_rel)) {
+                fiber.Schedule();
+            }
+        }
+    };
+
+    // resumes the select without the value
+    class SelectStopCallback : public Cancellation::StopCallback {
+    public:
+        explicit SelectStopCallback(SelectState& state) : state_(state) {
+        }
+
+        void OnStop() override {
+            if (!state_.acquired.exchange(true, std::memory_order_acq_rel)) {
+                state_.ResumeOnce();
+            }
+        }
+
     private:
-        using AwaitersArray = std::array<std::pair<Intrusive::BidirectionalListNode*, Intrusive::List*>, Size>;
+        SelectState& state_;
+    };
 
+    // awaiters of the select are unlinked by its fiber after the resume, not by the winner,
+    // because the winner holds only the spinlock of its own channel
+    template <typename T, typename Variant>
+    class SelectorAwaiter : public IChannelConsumerAwaiter<T> {
     public:
-        SelectorAwaiter(FiberHandle fiber, Variant& result, AwaitersArray& awaiters, std::atomic_flag& is_result_set) :
-        fiber_(fiber), result_(result), awaiters_(awaiters), is_result_set_(is_result_set) {
-            awaiters_[index_] = { this, nullptr };
+        SelectorAwaiter(SelectState& state, Variant& result) : state_(state), result_(result) {
         }
 
         void AwaitSuspend() override {
-            if (is_result_set_.test_and_set(std::memory_order_acquire)) {
-                fiber_.Schedule();
-            }
+            state_.ResumeOnce();
+        }
+
+        bool TryAcquire() override {
+            queue_ = nullptr;
+            return !state_.acquired.exchange(true, std::memory_order_acq_rel);
         }
 
         void Resume(T&& result) override {
             result_ = std::move(result);
-            for (size_t i = 0; i < Size; ++i) {
-                if (i != index_ && awaiters_[i].second != nullptr) {
-                    awaiters_[i].second->Unlink(awaiters_[i].first);
-                }
-            }
-            if (is_result_set_.test_and_set(std::memory_order_release)) {
-                fiber_.Schedule();
-            }
+            state_.ResumeOnce();
         }
 
-        void SetQueue(Intrusive::List* list) override {
-            awaiters_[index_] = { awaiters_[index_].first, list };
+        void SetQueue(Intrusive::List* queue) override {
+            queue_ = queue;
         }
 
-        void SetIndex(int index) override {
-            index_ = index;
+        Intrusive::List* GetQueue() override {
+            return queue_;
         }
 
     private:
-        FiberHandle fiber_;
+        SelectState& state_;
         Variant& result_;
-        AwaitersArray& awaiters_;
-        size_t index_ = 0;
-        std::atomic_flag& is_result_set_;
+        Intrusive::List* queue_ = nullptr;
     };
 
 }
\ No newline at end of file
@@ -1,23 +1,29 @@
 #include "fiber.hpp"
 #include "fiber_handle.hpp"
 #include "iawaiter.hpp"
+#include "../detail/timer_thread.hpp"
 
 namespace Fibers {
 
     thread_local Fiber* current_fiber = nullptr;
 
     ////FIBER_FUNCTOR
-    void FiberFunctor::operator()() {
+    void FiberFunctor::Resume() {
         current_fiber = fiber_;
         coroutine_->Resume();
-        if (!coroutine_->IsCompleted()) {
-            (*awaiter_)->AwaitSuspend();
+    }
+
+    void FiberFunctor::Complete() {
+        if (coroutine_->IsCompleted()) {
+            Fiber::Destroy(fiber_);
+            return;
         }
+        (*awaiter_)->AwaitSuspend();
     }
 
     //// FIBER
-    Fiber::Fiber(std::function<void()> routine,
-                 Executors::IExecutor& executor) : coroutine_(std::move(routine)), executor_(&executor) {
+    void Fiber::Destroy(Fiber* fiber) {
+        fiber->~Fiber();
     }
 
     void Fiber::Schedule() {
@@ -28,13 +34,25 @@ namespace Fibers {
         executor_->YieldExecute(&step_);
     }
 
-    void Fiber::Suspend(Awaiters::IAwaiter* awaiter) {
-        awaiter_ = awaiter;
+    void Fiber::ScheduleAt(Executors::Clock::time_point deadline) {
+        ExecuteAt(deadline, &step_);
+    }
 
-        // because after suspend we want to reschedule this fiber,
-        // and we shouldn't delete this
-        step_.need_to_delete_after_discard_ = false;
+    void Fiber::ExecuteAt(Executors::Clock::time_point deadline, Routine* routine) {
+        // executors without timers share one timer thread
+        if (!executor_->ExecuteAt(deadline, routine)) {
+            Detail::TimerThread::Instance().ExecuteAt(*executor_, deadline, routine);
+        }
+    }
+
+    void Fiber::ExecuteTimerAt(Executors::Clock::time_point deadline, Executors::TimerRoutine* routine) {
+        if (!executor_->ExecuteTimerAt(deadline, routine)) {
+            Detail::TimerThread::Instance().ExecuteAt(*executor_, deadline, routine);
+        }
+    }
 
+    void Fiber::Suspend(Awaiters::IAwaiter* awaiter) {
+        awaiter_ = awaiter;
         coroutine_.Suspend();
     }
 
@@ -55,6 +73,18 @@ namespace Fibers {
         fiber_->YieldSchedule();
     }
 
+    void FiberHandle::ScheduleAt(Executors::Clock::time_point deadline) {
+        fiber_->ScheduleAt(deadline);
+    }
+
+    void FiberHandle::ExecuteAt(Executors::Clock::time_point deadline, Executors::Routine* routine) {
+        fiber_->ExecuteAt(deadline, routine);
+    }
+
+    void FiberHandle::ExecuteTimerAt(Executors::Clock::time_point deadline, Executors::TimerRoutine* routine) {
+        fiber_->ExecuteTimerAt(deadline, routine);
+    }
+
     void FiberHandle::Suspend(Awaiters::IAwaiter* awaiter) {
         fiber_->Suspend(awaiter);
     }
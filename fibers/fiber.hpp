@@ -6,6 +6,7 @@
 #include "iawaiter.hpp"
 #include "awaiters.hpp"
 #include <functional>
+#include <new>
 #include "fiber_handle.hpp"
 
 namespace Fibers {
@@ -17,25 +18,35 @@ namespace Fibers {
     template <typename Functor>
     class FiberTask : public Intrusive::TaskBase {
     public:
-        friend Fiber;
-
         FiberTask(Functor func, Fiber* fiber) : func_(std::move(func)), owning_fiber_(fiber) {
+            trampoline_ = &RunStep;
         }
 
         bool AllocatedOnHeap() override {
             return true;
         }
 
+        // executors without the trampoline call Run and then Discard, so Run only resumes the coroutine
+        // and Discard finishes the step, until then the fiber isn't visible to the other threads
         void Run() override {
-            func_();
+            func_.Resume();
+            resumed_ = true;
         }
 
+        // for the step, that never runs (executor is stopped), the fiber is freed with it
         void Discard() override;
 
+    private:
+        // the step isn't touched after func_ : the fiber may be already rescheduled by its awaiter
+        // and run on the other thread, or freed, when the coroutine is completed
+        static void RunStep(TaskBase* task) {
+            static_cast<FiberTask*>(task)->func_();
+        }
+
     private:
         Functor func_;
         Fiber* owning_fiber_;
-        bool need_to_delete_after_discard_ = true;
+        bool resumed_ = false;
     };
 
 
@@ -45,7 +56,15 @@ namespace Fibers {
                 Fiber* fiber) : coroutine_(coroutine), awaiter_(awaiter), fiber_(fiber) {
         }
 
-        void operator()();
+        void operator()() {
+            Resume();
+            Complete();
+        }
+
+        void Resume();
+
+        // frees the completed fiber or passes the suspended one to its awaiter
+        void Complete();
 
     private:
         Coroutine* coroutine_;
@@ -56,12 +75,27 @@ namespace Fibers {
 
     class Fiber {
     public:
-        explicit Fiber(std::function<void()> routine, Executors::IExecutor& executor);
+        // fiber lives at the top of its own stack from StackPool, the body is placed right below it,
+        // so the spawn doesn't allocate anything besides the stack, which is usually recycled
+        template <typename Body>
+        static Fiber* Create(Body&& body, Executors::IExecutor& executor);
+
+        // fiber memory goes back to StackPool with its stack
+        static void Destroy(Fiber* fiber);
 
         void Schedule();
 
         void YieldSchedule();
 
+        // fiber is scheduled not earlier than deadline
+        void ScheduleAt(Executors::Clock::time_point deadline);
+
+        // routine runs on the executor of the fiber not earlier than deadline
+        void ExecuteAt(Executors::Clock::time_point deadline, Routine* routine);
+
+        // the same for the timer, that can be cancelled before the deadline
+        void ExecuteTimerAt(Executors::Clock::time_point deadline, Executors::TimerRoutine* routine);
+
         void Suspend(Awaiters::IAwaiter* awaiter);
 
         Executors::IExecutor& GetScheduler();
@@ -69,6 +103,13 @@ namespace Fibers {
         static FiberHandle Self();
 
     private:
+        template <typename Body>
+        Fiber(Body&& body, Executors::IExecutor& executor, boost::context::preallocated stack) :
+              coroutine_(std::forward<Body>(body), stack), executor_(&executor) {
+        }
+
+    private:
+        // destroyed last : it returns the stack, where the fiber itself lives
         Coroutine coroutine_;
         Awaiters::IAwaiter* awaiter_ = nullptr;
 
@@ -77,13 +118,32 @@ namespace Fibers {
         Executors::IExecutor* executor_ = nullptr;
     };
 
+    template <typename Body>
+    Fiber* Fiber::Create(Body&& body, Executors::IExecutor& executor) {
+        auto stack = Coroutines::Stackful::StackPool::Allocate();
+
+        // coroutine gets the rest of the stack below the fiber
+        auto top = (uintptr_t)stack.sp;
+        auto fiber_address = (top - sizeof(Fiber)) & ~(uintptr_t)(alignof(Fiber) - 1);
+        boost::context::preallocated coroutine_stack((void*)fiber_address, stack.size - (top - fiber_address), stack);
+
+        try {
+            return new ((void*)fiber_address) Fiber(std::forward<Body>(body), executor, coroutine_stack);
+        }
+        catch (...) {
+            Coroutines::Stackful::StackPool::Deallocate(stack);
+            throw;
+        }
+    }
+
     template <typename Functor>
     void FiberTask<Functor>::Discard() {
-        if (need_to_delete_after_discard_) {
-            delete owning_fiber_;
-        }
-        else {
-            need_to_delete_after_discard_ = true;
+        if (resumed_) {
+            // the step may be scheduled again by the awaiter
+            resumed_ = false;
+            func_.Complete();
+            return;
         }
+        Fiber::Destroy(owning_fiber_);
     }
 }
\ No newline at end of file
@@ -23,6 +23,12 @@ namespace Fibers {
 
         void YieldSchedule();
 
+        void ScheduleAt(Executors::Clock::time_point deadline);
+
+        void ExecuteAt(Executors::Clock::time_point deadline, Executors::Routine* routine);
+
+        void ExecuteTimerAt(Executors::Clock::time_point deadline, Executors::TimerRoutine* routine);
+
         void Suspend(Awaiters::IAwaiter* awaiter);
 
         Executors::IExecutor& GetScheduler();
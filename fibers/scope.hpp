@@ -0,0 +1,79 @@
+#pragma once
+
+#include "api.hpp"
+#include "sync/waitgroup.hpp"
+#include "../detail/scope_state.hpp"
+#include <utility>
+
+namespace Fibers {
+
+    // structured concurrency : children of the scope are joined before the scope ends
+    //
+    // usage (in a fiber) :
+    // Fibers::Scope scope;
+    // scope.Go([&]() { ... });
+    // scope.Join(); // <-- rethrows the first exception of the children
+    //
+    // the first exception cancels the siblings, they check IsCancelled
+    class Scope {
+    public:
+        // children run on the executor of the current fiber
+        Scope() : Scope(Fiber::Self().GetScheduler()) {
+        }
+
+        explicit Scope(Executors::IExecutor& executor) : executor_(executor) {
+        }
+
+        // Non-copyable
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        // the fiber waits for the children, exception isn't rethrown here
+        ~Scope() noexcept {
+            wait_group_.Wait();
+        }
+
+        template <typename Body>
+        void Go(Body&& body) {
+            wait_group_.Add(1);
+            Fibers::Go(executor_, [this, body = std::forward<Body>(body)]() mutable {
+                if (!state_.IsCancelled()) {
+                    try {
+                        body();
+                    }
+                    catch (...) {
+                        state_.SetException(std::current_exception());
+                    }
+                }
+                // Done doesn't touch the wait group, after Join can return, so the scope can be destroyed
+                // right after it
+                wait_group_.Done();
+            });
+        }
+
+        // suspends the fiber, not the thread, after it the scope can be reused
+        void Join() {
+            wait_group_.Wait();
+            state_.ResetAndRethrow();
+        }
+
+        void Cancel() {
+            state_.Cancel();
+        }
+
+        [[nodiscard]] bool IsCancelled() const {
+            return state_.IsCancelled();
+        }
+
+        // for the blocking operations of the children
+        [[nodiscard]] Cancellation::StopToken GetToken() const {
+            return state_.GetToken();
+        }
+
+    private:
+        Executors::IExecutor& executor_;
+        Sync::WaitGroup wait_group_;
+        ::Detail::ScopeState state_;
+    };
+
+}
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "../awaiters.hpp"
-#include "../../intrusive/structures/queue.hpp"
+#include "../../intrusive/structures/list.hpp"
 #include "../fiber.hpp"
 
 namespace Fibers::Sync {
@@ -12,29 +12,51 @@ namespace Fibers::Sync {
             mutex.unlock();
             ::Detail::QueueSpinLock::Guard guard(spinlock_);
             Awaiters::MutexAwaiter awaiter(Fiber::Self(), guard);
-            queue_.Push(&awaiter);
+            queue_.PushBack(&awaiter);
             Fiber::Self().Suspend(&awaiter); // here spinlock unlocks
             mutex.lock();
         }
 
+        // return false if deadline fires before the notification, mutex is locked again anyway
+        template <typename Mutex>
+        bool WaitUntil(Mutex& mutex, Executors::Clock::time_point deadline) {
+            mutex.unlock();
+            ::Detail::QueueSpinLock::Guard guard(spinlock_);
+            auto self = Fiber::Self();
+            Awaiters::ListTimeout timeout(self, deadline, queue_, spinlock_);
+            Awaiters::MutexAwaiter awaiter(self, guard, &timeout);
+            queue_.PushBack(&awaiter);
+            self.Suspend(&awaiter); // here spinlock unlocks
+            mutex.lock();
+            return !timeout.Expired();
+        }
+
+        template <typename Mutex>
+        bool WaitFor(Mutex& mutex, Executors::Clock::duration timeout) {
+            return WaitUntil(mutex, Executors::Clock::now() + timeout);
+        }
+
+        // timed out awaiters are skipped, they leave by themselves
         void NotifyOne() {
             ::Detail::QueueSpinLock::Guard guard(spinlock_);
-            if (queue_.Size() > 0) {
-                auto* awaiter = (Awaiters::MutexAwaiter*)queue_.TryPop();
-                awaiter->Resume();
+            while (queue_.Size() > 0) {
+                auto* awaiter = (Awaiters::MutexAwaiter*)queue_.TryPopFront();
+                if (awaiter->TryResume()) {
+                    return;
+                }
             }
         }
 
         void NotifyAll() {
             ::Detail::QueueSpinLock::Guard guard(spinlock_);
             while (queue_.Size() > 0) {
-                auto* awaiter = (Awaiters::MutexAwaiter*)queue_.TryPop();
-                awaiter->Resume();
+                auto* awaiter = (Awaiters::MutexAwaiter*)queue_.TryPopFront();
+                awaiter->TryResume();
             }
         }
 
     private:
         Detail::QueueSpinLock spinlock_;
-        Intrusive::Queue queue_;
+        Intrusive::List queue_;
     };
-}
\ No newline at end of file
+}
@@ -3,7 +3,7 @@
 #include "../fiber.hpp"
 #include "../awaiters.hpp"
 #include "../../detail/spinlock.hpp"
-#include "../../intrusive/structures/queue.hpp"
+#include "../../intrusive/structures/list.hpp"
 
 namespace Fibers::Sync {
 
@@ -17,27 +17,70 @@ namespace Fibers::Sync {
             }
 
             Awaiters::MutexAwaiter awaiter(Fiber::Self(), guard);
-            queue_.Push(&awaiter);
+            queue_.PushBack(&awaiter);
             Fiber::Self().Suspend(&awaiter);
         }
 
-        void Unlock() {
+        bool TryLock() {
             Detail::QueueSpinLock::Guard guard(spinlock_);
+            if (!closed_) {
+                closed_ = true;
+                return true;
+            }
+            return false;
+        }
 
-            if (queue_.Size() > 0) {
-                auto* awaiter = (Awaiters::MutexAwaiter*)queue_.TryPop();
-                awaiter->Resume();
+        // return false if deadline fires before the mutex is handed over
+        bool TryLockUntil(Executors::Clock::time_point deadline) {
+            Detail::QueueSpinLock::Guard guard(spinlock_);
+            if (!closed_) {
+                closed_ = true;
+                return true;
             }
-            else {
-                closed_ = false;
+
+            auto self = Fiber::Self();
+            Awaiters::ListTimeout timeout(self, deadline, queue_, spinlock_);
+            Awaiters::MutexAwaiter awaiter(self, guard, &timeout);
+            queue_.PushBack(&awaiter);
+            self.Suspend(&awaiter);
+            return !timeout.Expired();
+        }
+
+        bool TryLockFor(Executors::Clock::duration timeout) {
+            return TryLockUntil(Executors::Clock::now() + timeout);
+        }
+
+        void Unlock() {
+            Detail::QueueSpinLock::Guard guard(spinlock_);
+
+            // timed out awaiters are skipped, they leave by themselves
+            while (queue_.Size() > 0) {
+                auto* awaiter = (Awaiters::MutexAwaiter*)queue_.TryPopFront();
+                if (awaiter->TryResume()) {
+                    return;
+                }
             }
+            closed_ = false;
         }
 
-        // basic lockable
+        // timed lockable
         void lock() {
             Lock();
         }
 
+        bool try_lock() {
+            return TryLock();
+        }
+
+        template <typename Rep, typename Period>
+        bool try_lock_for(const std::chrono::duration<Rep, Period>& timeout) {
+            return TryLockFor(std::chrono::duration_cast<Executors::Clock::duration>(timeout));
+        }
+
+        bool try_lock_until(Executors::Clock::time_point deadline) {
+            return TryLockUntil(deadline);
+        }
+
         void unlock() {
             Unlock();
         }
@@ -45,7 +88,7 @@ namespace Fibers::Sync {
     private:
         Detail::QueueSpinLock spinlock_;
         bool closed_ = false;
-        Intrusive::Queue queue_;
+        Intrusive::List queue_;
     };
 
-}
\ No newline at end of file
+}
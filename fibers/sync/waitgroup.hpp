@@ -2,6 +2,9 @@
 
 #include "../awaiters.hpp"
 #include "../fiber.hpp"
+#include "../../detail/spinlock.hpp"
+#include "../../intrusive/structures/list.hpp"
+#include <thread>
 
 namespace Fibers::Sync {
 
@@ -11,37 +14,89 @@ namespace Fibers::Sync {
             count_.fetch_add((long long)count, std::memory_order_release);
         }
 
+        // the last Done marks the count as released, waiters don't return until the mark is cleared,
+        // so the wait group isn't touched after it can be destroyed by a resumed or a passing fiber
         void Done() {
-            if (count_.fetch_sub(1, std::memory_order_release) == 1) {
-                auto* old_head = head_.load(std::memory_order_relaxed);
-                while (!head_.compare_exchange_weak(old_head, nullptr, std::memory_order_acquire,
-                                                    std::memory_order_relaxed)) {
-                }
-                ResumeAwaiters(old_head);
+            long long count = count_.load(std::memory_order_relaxed);
+            while (!count_.compare_exchange_weak(count, (count == 1 ? kReleasing : count - 1),
+                                                 std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            }
+            if (count == 1) {
+                Release();
             }
         }
 
         void AllDone() {
-            count_.store(0, std::memory_order_release);
-            auto* old_head = head_.load(std::memory_order_relaxed);
-            while (!head_.compare_exchange_weak(old_head, nullptr, std::memory_order_acquire,
-                                                std::memory_order_relaxed)) {
-            }
-            ResumeAwaiters(old_head);
+            count_.store(kReleasing, std::memory_order_seq_cst);
+            Release();
         }
 
         void Wait() {
-            if (count_.load(std::memory_order_acquire) == 0) {
+            if (LoadCount() == 0) {
                 return;
             }
 
             std::atomic_flag resumed{ false };
             Awaiters::WaitGroupAwaiter awaiter(Fiber::Self(), resumed);
             PushInStack(&awaiter);
+
+            // Done could take the stack before the push, then nobody else resumes it,
+            // seq_cst : either Done sees the awaiter in the stack, or the zero is seen here
+            if (LoadCount() == 0) {
+                ResumeAwaiters(head_.exchange(nullptr, std::memory_order_seq_cst));
+            }
             Fiber::Self().Suspend(&awaiter);
         }
 
+        // return false if deadline fires before the count becomes zero
+        bool WaitUntil(Executors::Clock::time_point deadline) {
+            if (LoadCount() == 0) {
+                return true;
+            }
+
+            // timed awaiters can leave on timeout, so they wait in the list under spinlock,
+            // Done marks the release before it takes spinlock, so zero can't be missed here
+            bool expired = false;
+            {
+                ::Detail::QueueSpinLock::Guard guard(spinlock_);
+                if ((count_.load(std::memory_order_acquire) & ~kReleasing) != 0) {
+                    auto self = Fiber::Self();
+                    Awaiters::ListTimeout timeout(self, deadline, timed_awaiters_, spinlock_);
+                    Awaiters::MutexAwaiter awaiter(self, guard, &timeout);
+                    timed_awaiters_.PushBack(&awaiter);
+                    self.Suspend(&awaiter);
+                    expired = timeout.Expired();
+                }
+            }
+
+            // Done may be releasing, even if the deadline has fired, and it may still hold spinlock
+            LoadCount();
+            return !expired;
+        }
+
+        bool WaitFor(Executors::Clock::duration timeout) {
+            return WaitUntil(Executors::Clock::now() + timeout);
+        }
+
     private:
+        // the plain awaiters are resumed after the mark is cleared, they are on the stacks of their fibers
+        void Release() {
+            ResumeTimedAwaiters();
+            auto* stack = head_.exchange(nullptr, std::memory_order_seq_cst);
+            // the last access to the wait group
+            count_.fetch_sub(kReleasing, std::memory_order_seq_cst);
+            ResumeAwaiters(stack);
+        }
+
+        // waits while the last Done releases the waiters, Add may come on the way
+        long long LoadCount() {
+            long long count;
+            while (((count = count_.load(std::memory_order_seq_cst)) & kReleasing) != 0) {
+                std::this_thread::yield();
+            }
+            return count;
+        }
+
         static void ResumeAwaiters(Awaiters::WaitGroupAwaiter* stack) {
             if (stack == nullptr) {
                 return;
@@ -56,9 +111,19 @@ namespace Fibers::Sync {
             }
         }
 
+        void ResumeTimedAwaiters() {
+            ::Detail::QueueSpinLock::Guard guard(spinlock_);
+            while (timed_awaiters_.Size() > 0) {
+                auto* awaiter = (Awaiters::MutexAwaiter*)timed_awaiters_.TryPopFront();
+                awaiter->TryResume();
+            }
+        }
+
         static Awaiters::WaitGroupAwaiter* CreateQueueFromStack(Awaiters::WaitGroupAwaiter* stack) {
             auto* next_queue_head = (Awaiters::WaitGroupAwaiter*)stack->next;
             Awaiters::WaitGroupAwaiter* queue_head = stack;
+            // the old head becomes the tail of the queue
+            stack->next = nullptr;
             while (next_queue_head != nullptr) {
                 Awaiters::WaitGroupAwaiter* next_queue_head_copy = next_queue_head;
                 next_queue_head = (Awaiters::WaitGroupAwaiter*)next_queue_head->next;
@@ -73,14 +138,19 @@ namespace Fibers::Sync {
             result = head_.load(std::memory_order_relaxed);
             do {
                 awaiter->next = result;
-            } while (!head_.compare_exchange_strong(result, awaiter, std::memory_order_release,
+            } while (!head_.compare_exchange_strong(result, awaiter, std::memory_order_seq_cst,
                                                           std::memory_order_relaxed));
             return result;
         }
 
     private:
+        static const long long kReleasing = (1LL << 62);
+
         std::atomic<Awaiters::WaitGroupAwaiter*> head_{ nullptr };
         std::atomic<long long> count_{ 0 };
+
+        ::Detail::QueueSpinLock spinlock_;
+        Intrusive::List timed_awaiters_;
     };
 
 }
\ No newline at end of file
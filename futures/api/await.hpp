@@ -0,0 +1,87 @@
+#pragma once
+
+#include "future.hpp"
+#include <coroutine>
+
+namespace Futures {
+
+    namespace Detail {
+
+        // semi future has no executor, so the coroutine is resumed by the thread which sets the value
+        class InlineExecutor : public Executors::IExecutor {
+        public:
+            // never destroyed : promises can be set after static destructors
+            static InlineExecutor& Instance() {
+                static auto* instance = new InlineExecutor;
+                return *instance;
+            }
+
+            void Execute(Executors::Routine* routine) override {
+                routine->RunAndDiscard();
+            }
+
+            void YieldExecute(Executors::Routine* routine) override {
+                routine->RunAndDiscard();
+            }
+        };
+
+    }
+
+    // usage : T value = co_await std::move(future);
+    //
+    // the awaiter lives in the coroutine frame and takes the callback slot of the future,
+    // so the coroutine is resumed on the executor of the future without the callback allocation
+    template <typename T>
+    class FutureAwaiter : public ICallback<T> {
+    public:
+        using FutureType = typename Detail::ChangeVoidOnMonostate<T>::Type;
+
+        explicit FutureAwaiter(Future<T>&& future) : future_(std::move(future)) {
+        }
+
+        bool await_ready() {
+            if (!future_.IsReady()) {
+                return false;
+            }
+            result_ = GetResult(std::move(future_));
+            return true;
+        }
+
+        // the coroutine can be resumed before SetCallback returns, so the awaiter isn't touched after it
+        void await_suspend(std::coroutine_handle<> caller) {
+            caller_ = caller;
+            future_.SetCallback(this);
+        }
+
+        // exception of the future is rethrown
+        T await_resume() {
+            if constexpr (std::is_void_v<T>) {
+                result_.ValueOrThrow();
+            }
+            else {
+                return result_.ValueOrThrow();
+            }
+        }
+
+        void Invoke(Result<FutureType>&& result) noexcept override {
+            result_ = std::move(result);
+            caller_.resume();
+        }
+
+    private:
+        Future<T> future_;
+        Result<FutureType> result_;
+        std::coroutine_handle<> caller_;
+    };
+
+    template <typename T>
+    FutureAwaiter<T> operator co_await(Future<T>&& future) {
+        return FutureAwaiter<T>(std::move(future));
+    }
+
+    template <typename T>
+    FutureAwaiter<T> operator co_await(SemiFuture<T>&& future) {
+        return FutureAwaiter<T>(std::move(future).Via(Detail::InlineExecutor::Instance()));
+    }
+
+}
@@ -5,16 +5,22 @@
 namespace Futures {
 
     // usage : auto f = Futures::Execute(exec, []() -> T { return T; })
+    //
+    // functor is skipped, if stop is requested before it runs, then the result is OperationCancelled
     template <typename Functor>
-    auto Execute(Executors::IExecutor& executor, Functor functor) {
+    auto Execute(Executors::IExecutor& executor, Functor functor, Cancellation::StopToken token = {}) {
         using ReturnType = std::invoke_result_t<Functor>;
         auto [f, p] = MakeContract<ReturnType>();
 
 
-        Executors::Execute(executor, [promise = std::move(p), functor = std::move(functor)]() mutable {
+        Executors::Execute(executor, [promise = std::move(p), functor = std::move(functor),
+                                      token = std::move(token)]() mutable {
             // callback will delete itself
             Result<typename Detail::ChangeVoidOnMonostate<ReturnType>::Type> result;
             try {
+                if (token.StopRequested()) {
+                    throw Cancellation::OperationCancelled();
+                }
                 using Calculate = typename Detail::CalculateFunction</*Functor=*/Functor,
                         /*ReturnType=*/ReturnType,
                         /*ArgType=*/void,
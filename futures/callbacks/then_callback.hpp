@@ -2,6 +2,7 @@
 
 #include "icallback.hpp"
 #include "../promise.hpp"
+#include "../../cancellation/stop_token.hpp"
 
 namespace Futures {
 
@@ -19,12 +20,18 @@ namespace Futures {
                                                              /*FutureType=*/FutureType>;
 
         explicit ThenCallback(Functor func,
-                              Promise<ReturnType> promise) : func_(std::move(func)), promise_(std::move(promise)) {
+                              Promise<ReturnType> promise,
+                              Cancellation::StopToken token = {}) : func_(std::move(func)), promise_(std::move(promise)),
+                                                                    token_(std::move(token)) {
         }
 
+        // after the stop request functor is skipped, and the rest of the chain gets OperationCancelled
         void Invoke(Result<FutureType>&& result) noexcept override {
             Result<FutureReturnType> res;
             try {
+                if (token_.StopRequested()) {
+                    throw Cancellation::OperationCancelled();
+                }
                 res.SetValue(std::move(Calculate::Calculate(std::move(func_), std::move(result.ValueOrThrow()))));
             }
             catch(...) {
@@ -37,6 +44,7 @@ namespace Futures {
     private:
         Functor func_;
         Promise<ReturnType> promise_;
+        Cancellation::StopToken token_;
     };
 
 
@@ -13,6 +13,9 @@ namespace Futures {
     template <typename ReturnType>
     class SemiFuture;
 
+    template <typename T>
+    class FutureAwaiter;
+
     template <typename T>
     struct Contract {
         SemiFuture<T> future;
@@ -30,6 +33,8 @@ namespace Futures {
 
         friend SemiFuture<T>;
 
+        friend FutureAwaiter<T>;
+
         // if T != void : FutureType = T; else FutureType == std::monostate
         using FutureType = typename Detail::ChangeVoidOnMonostate<T>::Type;
         using ValueType = T;
@@ -44,7 +49,14 @@ namespace Futures {
         template <typename Functor>
         auto Then(Functor functor) && {
             using ReturnType = typename Detail::GetReturnType<Functor, ValueType>::Type;
-            return std::move(ThenImpl<ReturnType, Functor>(std::move(functor)));
+            return std::move(ThenImpl<ReturnType, Functor>(std::move(functor), {}));
+        }
+
+        // functor is skipped, if stop is requested before it runs, then the result is OperationCancelled
+        template <typename Functor>
+        auto Then(Functor functor, Cancellation::StopToken token) && {
+            using ReturnType = typename Detail::GetReturnType<Functor, ValueType>::Type;
+            return std::move(ThenImpl<ReturnType, Functor>(std::move(functor), std::move(token)));
         }
 
         template <typename Functor>
@@ -61,7 +73,7 @@ namespace Futures {
         Future(Executors::IExecutor& executor, FutureValue<ValueType>* value);
 
         template <typename ReturnType, typename Functor>
-        SemiFuture<ReturnType> ThenImpl(Functor functor);
+        SemiFuture<ReturnType> ThenImpl(Functor functor, Cancellation::StopToken token);
 
         void SetCallback(ICallback<T>* callback);
 
@@ -176,10 +188,10 @@ namespace Futures {
 
     template <typename T>
     template <typename ReturnType, typename Functor>
-    SemiFuture<ReturnType> Future<T>::ThenImpl(Functor functor) {
+    SemiFuture<ReturnType> Future<T>::ThenImpl(Functor functor, Cancellation::StopToken token) {
         auto [f, p] = std::move(Contract<ReturnType>(new FutureValue<ReturnType>)); // MakeContract<ReturnType>();
 
-        auto* callback = new ThenCallback<T, Functor>(std::move(functor), std::move(p));
+        auto* callback = new ThenCallback<T, Functor>(std::move(functor), std::move(p), std::move(token));
         SetCallback(callback);
 
         return std::move(f);
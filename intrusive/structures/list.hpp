@@ -41,6 +41,7 @@ namespace Intrusive {
         void PushBack(Node* node) {
             if (size_ == 0) {
                 PushFront(node);
+                return;
             }
 
             ++size_;
@@ -87,6 +87,14 @@ namespace Intrusive {
             size_ = 0;
         }
 
+        [[nodiscard]] Node* Front() const {
+            return head_;
+        }
+
+        [[nodiscard]] Node* Back() const {
+            return tail_;
+        }
+
         [[nodiscard]] size_t Size() const {
             return size_;
         }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "task_base.hpp"
+#include "../../detail/slab_allocator.hpp"
 #include <iostream>
 #include <cassert>
 
@@ -9,8 +10,18 @@ namespace Intrusive {
     template <typename Functor>
     class DefaultTask : public TaskBase {
     public:
-        DefaultTask(Functor&& func, bool is_allocated_on_heap) : func_(std::forward<Functor>(func)),
-                                                                 is_allocated_on_head_(is_allocated_on_heap) {
+        template <typename F>
+        DefaultTask(F&& func, bool is_allocated_on_heap) : func_(std::forward<F>(func)),
+                                                           is_allocated_on_head_(is_allocated_on_heap) {
+        }
+
+        // tasks are allocated for every submission, so they live in the per-thread slabs
+        static void* operator new(size_t size) {
+            return Detail::SlabAllocator::Allocate(size, alignof(DefaultTask));
+        }
+
+        static void operator delete(void* ptr, size_t size) {
+            Detail::SlabAllocator::Deallocate(ptr, size, alignof(DefaultTask));
         }
 
         bool AllocatedOnHeap() override {
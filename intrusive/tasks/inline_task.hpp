@@ -0,0 +1,63 @@
+#pragma once
+
+#include "task_base.hpp"
+#include "../../detail/slab_allocator.hpp"
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace Intrusive {
+
+    constexpr size_t kInlineTaskSize = 64;
+
+    // functor fits into the inline task cell
+    template <typename Functor>
+    constexpr bool kFitsInlineTask = (sizeof(TaskBase) + sizeof(Functor) <= kInlineTaskSize &&
+                                      alignof(Functor) <= alignof(std::max_align_t));
+
+    // cache line sized task cell with the functor stored inline,
+    // executors run and free it by one call of the trampoline instead of three virtual calls
+    // all cells have the same size, so they share one size class of the slab allocator
+    template <typename Functor>
+    class alignas(kInlineTaskSize) InlineTask final : public TaskBase {
+        static_assert(kFitsInlineTask<Functor>);
+
+    public:
+        template <typename F>
+        explicit InlineTask(F&& func) : func_(std::forward<F>(func)) {
+            trampoline_ = &RunAndDelete;
+        }
+
+        static void* operator new(size_t size) {
+            return Detail::SlabAllocator::Allocate(size, alignof(InlineTask));
+        }
+
+        static void operator delete(void* ptr, size_t size) {
+            Detail::SlabAllocator::Deallocate(ptr, size, alignof(InlineTask));
+        }
+
+        bool AllocatedOnHeap() override {
+            return true;
+        }
+
+        void Run() override {
+            func_();
+        }
+
+        void Discard() override {
+            delete this;
+        }
+
+    private:
+        static void RunAndDelete(TaskBase* task) {
+            auto* self = static_cast<InlineTask*>(task);
+            self->func_();
+            // InlineTask is final, so there is no virtual call
+            delete self;
+        }
+
+    private:
+        Functor func_;
+    };
+
+}
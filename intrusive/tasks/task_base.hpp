@@ -6,6 +6,29 @@
 namespace Intrusive {
 
     class TaskBase : public ITask, public SinglyDirectedListNode {
+    public:
+        // runs the task and frees it, if it is allocated on heap
+        void RunAndDiscard() {
+            // task with the trampoline does all of it by one indirect call
+            if (trampoline_ != nullptr) {
+                trampoline_(this);
+                return;
+            }
+
+            // if not allocated on heap,
+            // then task destroys after Run
+            // and Discard - UB
+            bool need_discard = AllocatedOnHeap();
+            Run();
+            if (need_discard) {
+                Discard();
+            }
+        }
+
+    protected:
+        using Trampoline = void (*)(TaskBase* task);
+
+        Trampoline trampoline_ = nullptr;
     };
 
-}
\ No newline at end of file
+}
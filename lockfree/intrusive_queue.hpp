@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include "../intrusive/structures/singly_directed_list_node.hpp"
+#include "../intrusive/structures/queue.hpp"
+
+namespace LockFree {
+
+    // multi-Producer / multi-Consumer intrusive queue (Vyukov MPSC queue + consumers token)
+    //
+    // producers never wait : push is one exchange on head_ and one store into the previous node,
+    // nodes are linked through SinglyDirectedListNode::next, so there is no allocation per push.
+    // consumers are serialized by consumer_token_, but they never wait too :
+    // if another consumer holds the token, TryPop and Grab return nothing and the caller goes elsewhere
+    class IntrusiveQueue {
+        using Node = Intrusive::SinglyDirectedListNode;
+
+    public:
+        IntrusiveQueue() = default;
+
+        IntrusiveQueue(const IntrusiveQueue&) = delete;
+        IntrusiveQueue& operator=(const IntrusiveQueue&) = delete;
+
+        IntrusiveQueue(IntrusiveQueue&&) = delete;
+        IntrusiveQueue& operator=(IntrusiveQueue&&) = delete;
+
+        ~IntrusiveQueue() noexcept = default;
+
+        void Push(Node* node) {
+            size_.fetch_add(1, std::memory_order_relaxed);
+            PushImpl(node, node);
+        }
+
+        // push all queue nodes with one exchange
+        void PushQueue(Intrusive::Queue&& queue) {
+            if (queue.Size() == 0) {
+                return;
+            }
+
+            size_.fetch_add(queue.Size(), std::memory_order_relaxed);
+            PushImpl(queue.Front(), queue.Back());
+            queue.Clear();
+        }
+
+        // return nullptr if queue is empty or another consumer holds the queue
+        Node* TryPop() {
+            if (consumer_token_.test_and_set(std::memory_order_acquire)) {
+                return nullptr;
+            }
+
+            Node* result = PopImpl();
+            consumer_token_.clear(std::memory_order_release);
+
+            if (result != nullptr) {
+                size_.fetch_sub(1, std::memory_order_relaxed);
+            }
+            return result;
+        }
+
+        // pop at most size nodes into queue, return count of popped nodes
+        size_t Grab(Intrusive::Queue& queue, size_t size) {
+            if (size == 0 || consumer_token_.test_and_set(std::memory_order_acquire)) {
+                return 0;
+            }
+
+            size_t grabbed_cnt = 0;
+            Node* node;
+            while (grabbed_cnt < size && (node = PopImpl()) != nullptr) {
+                queue.Push(node);
+                ++grabbed_cnt;
+            }
+            consumer_token_.clear(std::memory_order_release);
+
+            size_.fetch_sub(grabbed_cnt, std::memory_order_relaxed);
+            return grabbed_cnt;
+        }
+
+        // approximate count of nodes
+        [[nodiscard]] size_t Size() const {
+            return size_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        // first, ..., last must be linked through next
+        void PushImpl(Node* first, Node* last) {
+            NextOf(last).store(nullptr, std::memory_order_relaxed);
+            Node* prev = head_.exchange(last, std::memory_order_acq_rel);
+            NextOf(prev).store(first, std::memory_order_release);
+        }
+
+        // only for consumer token owner
+        Node* PopImpl() {
+            Node* tail = tail_;
+            Node* next = NextOf(tail).load(std::memory_order_acquire);
+
+            if (tail == &stub_) {
+                if (next == nullptr) {
+                    return nullptr;
+                }
+                tail_ = next;
+                tail = next;
+                next = NextOf(tail).load(std::memory_order_acquire);
+            }
+
+            if (next != nullptr) {
+                tail_ = next;
+                return tail;
+            }
+
+            // producer has exchanged head_ but hasn't linked the node yet,
+            // we will see it on the next try
+            if (tail != head_.load(std::memory_order_acquire)) {
+                return nullptr;
+            }
+
+            // tail is the last node, we can't pop it without the stub after it
+            PushImpl(&stub_, &stub_);
+            next = NextOf(tail).load(std::memory_order_acquire);
+            if (next != nullptr) {
+                tail_ = next;
+                return tail;
+            }
+
+            return nullptr;
+        }
+
+        static std::atomic_ref<Node*> NextOf(Node* node) {
+            return std::atomic_ref<Node*>(node->next);
+        }
+
+    private:
+        Node stub_;
+
+        // alignas(64) to avoid extra cache synchronizations between producers and consumers
+        alignas(64) std::atomic<Node*> head_{ &stub_ };
+        alignas(64) Node* tail_ = &stub_; // guarded by consumer_token_
+        std::atomic_flag consumer_token_{ false };
+        alignas(64) std::atomic<size_t> size_{ 0 };
+    };
+
+}
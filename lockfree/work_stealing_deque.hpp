@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <algorithm>
+
+namespace LockFree {
+
+    // Chase-Lev bounded work-stealing deque (with Le et al. memory orders)
+    //
+    // owner : TryPush and TryPop on the bottom end,
+    //         CAS happens only when the owner and a thief race for the last item
+    // thieves : Grab on the top end, one CAS on top_ per item
+    template <typename T, size_t Capacity>
+    class WorkStealingDeque {
+        struct Slot {
+            std::atomic<T*> item{ nullptr };
+        };
+
+    public:
+        // only for owner
+        bool TryPush(T* item) {
+            int64_t bottom = bottom_.load(std::memory_order_relaxed);
+            int64_t top = top_.load(std::memory_order_acquire);
+
+            if (bottom - top >= (int64_t)Capacity) {
+                return false;
+            }
+
+            buffer_[(uint64_t)bottom % Capacity].item.store(item, std::memory_order_relaxed);
+            bottom_.store(bottom + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        // only for owner
+        // returns nullptr if deque is empty
+        T* TryPop() {
+            int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+            bottom_.store(bottom, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t top = top_.load(std::memory_order_relaxed);
+
+            if (top > bottom) {
+                // deque is empty
+                bottom_.store(bottom + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            T* result = buffer_[(uint64_t)bottom % Capacity].item.load(std::memory_order_relaxed);
+            if (top == bottom) {
+                // last item, we race with thieves
+                if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                                  std::memory_order_relaxed)) {
+                    result = nullptr;
+                }
+                bottom_.store(bottom + 1, std::memory_order_relaxed);
+            }
+
+            return result;
+        }
+
+        // steals at most half of the items, but no more than size
+        template <typename Queue>
+        size_t Grab(Queue& queue, size_t size) {
+            size_t grabbed_cnt = 0;
+
+            while (grabbed_cnt < size) {
+                int64_t top = top_.load(std::memory_order_acquire);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                int64_t bottom = bottom_.load(std::memory_order_acquire);
+
+                if (top >= bottom) {
+                    break;
+                }
+
+                if (grabbed_cnt == 0) {
+                    size = std::min(size, (size_t)(bottom - top + 1) / 2);
+                }
+
+                T* item = buffer_[(uint64_t)top % Capacity].item.load(std::memory_order_relaxed);
+                if (top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                                 std::memory_order_relaxed)) {
+                    queue.Push(item);
+                    ++grabbed_cnt;
+                }
+            }
+
+            return grabbed_cnt;
+        }
+
+        // approximate count of items
+        [[nodiscard]] size_t Size() const {
+            int64_t top = top_.load(std::memory_order_relaxed);
+            int64_t bottom = bottom_.load(std::memory_order_relaxed);
+            return (bottom > top ? (size_t)(bottom - top) : 0);
+        }
+
+    private:
+        std::array<Slot, Capacity> buffer_;
+
+        // alignas(64) to avoid extra cache synchronizations between owner and thieves
+        alignas(64) std::atomic<int64_t> top_{ 0 };
+        alignas(64) std::atomic<int64_t> bottom_{ 0 };
+    };
+
+}